@@ -0,0 +1,185 @@
+#include "bench.hpp"
+
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <charconv>
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <print>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace chip8::bench
+{
+
+namespace
+{
+
+constexpr double ns_per_second = 1e9;
+
+// Text of the value of the given key in a flat JSON object, without the
+// quotes if it is a string. Good enough for the files written by Google
+// Benchmark, whose strings never contain escaped quotes.
+std::optional<std::string_view> find_value(std::string_view object,
+                                           std::string_view key)
+{
+    const std::string quoted = '"' + std::string(key) + "\":";
+    const auto key_pos       = object.find(quoted);
+    if (key_pos == std::string_view::npos)
+    {
+        return std::nullopt;
+    }
+
+    auto value = object.substr(key_pos + quoted.size());
+    value.remove_prefix(std::min(value.find_first_not_of(" \t\r\n"),
+                                 value.size()));
+    if (value.starts_with('"'))
+    {
+        value.remove_prefix(1);
+        return value.substr(0, value.find('"'));
+    }
+    return value.substr(0, value.find_first_of(",}\r\n"));
+}
+
+std::optional<double> to_ns(double time, std::string_view unit)
+{
+    if (unit == "ns")
+    {
+        return time;
+    }
+    if (unit == "us")
+    {
+        return time * 1e3;
+    }
+    if (unit == "ms")
+    {
+        return time * 1e6;
+    }
+    if (unit == "s")
+    {
+        return time * ns_per_second;
+    }
+    return std::nullopt;
+}
+
+} // namespace
+
+std::optional<Timings> read_timings(std::string const& path)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        std::println(std::cerr, "Error: cannot open the baseline {}", path);
+        return std::nullopt;
+    }
+    const std::string content{std::istreambuf_iterator<char>(file), {}};
+
+    Timings timings;
+    const auto benchmarks = content.find("\"benchmarks\":");
+    for (auto begin = content.find('{', benchmarks);
+         benchmarks != std::string::npos && begin != std::string::npos;
+         begin = content.find('{', begin + 1))
+    {
+        const auto end = content.find('}', begin);
+        if (end == std::string::npos)
+        {
+            break;
+        }
+        const auto object =
+            std::string_view(content).substr(begin, end - begin + 1);
+
+        const auto name     = find_value(object, "name");
+        const auto cpu_time = find_value(object, "cpu_time");
+        const auto unit     = find_value(object, "time_unit");
+        if (!name || !cpu_time || !unit ||
+            find_value(object, "error_occurred") == "true" ||
+            find_value(object, "aggregate_unit") == "percentage")
+        {
+            continue;
+        }
+
+        double time          = 0.0;
+        const auto [ptr, ec] = std::from_chars(
+            cpu_time->data(), cpu_time->data() + cpu_time->size(), time);
+        if (ec != std::errc{} || time <= 0.0)
+        {
+            continue;
+        }
+        if (const auto ns = to_ns(time, *unit))
+        {
+            timings[std::string(*name)] = *ns;
+        }
+    }
+
+    if (timings.empty())
+    {
+        std::println(std::cerr, "Error: no benchmark results in {}", path);
+        return std::nullopt;
+    }
+    return timings;
+}
+
+void TimingReporter::ReportRuns(std::vector<Run> const& reports)
+{
+    ConsoleReporter::ReportRuns(reports);
+
+    for (auto const& run : reports)
+    {
+        // Runs skipped because of an error have no iterations, the
+        // coefficients of variation are not times.
+        if (run.iterations == 0 ||
+            run.aggregate_unit == benchmark::StatisticUnit::kPercentage)
+        {
+            continue;
+        }
+        timings_[run.benchmark_name()] =
+            run.GetAdjustedCPUTime() * ns_per_second /
+            benchmark::GetTimeUnitMultiplier(run.time_unit);
+    }
+}
+
+std::size_t compare(Timings const& baseline, Timings const& current,
+                    double threshold)
+{
+    std::size_t width = std::string_view("Benchmark").size();
+    for (auto const& [name, time] : current)
+    {
+        width = std::max(width, name.size());
+    }
+
+    std::println("\n{:<{}} {:>14} {:>14} {:>8}", "Benchmark", width,
+                 "Baseline (ns)", "Current (ns)", "Change");
+
+    std::size_t regressions = 0;
+    std::size_t missing     = 0;
+    for (auto const& [name, time] : current)
+    {
+        const auto it = baseline.find(name);
+        if (it == baseline.end())
+        {
+            ++missing;
+            continue;
+        }
+
+        const double change  = (time / it->second - 1.0) * 100.0;
+        const bool regressed = change > threshold;
+        regressions += regressed ? 1 : 0;
+        std::println("{:<{}} {:>14.1f} {:>14.1f} {:>+7.1f}%{}", name, width,
+                     it->second, time, change,
+                     regressed ? "  REGRESSION" : "");
+    }
+
+    if (missing != 0)
+    {
+        std::println("Not in the baseline: {}", missing);
+    }
+    std::println("Slower by more than {:.1f}%: {}", threshold, regressions);
+
+    return regressions;
+}
+
+} // namespace chip8::bench
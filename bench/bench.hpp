@@ -0,0 +1,55 @@
+#ifndef CHIP_8_BENCH
+#define CHIP_8_BENCH
+
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace chip8::bench
+{
+
+// Registers, for each ROM, a benchmark that runs it headless in turbo mode
+// for the given number of instructions with every CPU backend, benchmarks of
+// running as many instructions on every lane of a VectorEngine, of forking
+// and restoring the machine, and of loading it from its file and from a
+// RomStore.
+void register_rom_benchmarks(std::span<const std::string> roms,
+                             uint64_t cycles);
+
+// CPU time per iteration of each benchmark, in nanoseconds, by name.
+using Timings = std::map<std::string, double>;
+
+// Reads the timings from a file written with --benchmark_out in the JSON
+// format. Returns std::nullopt if the file cannot be read or holds no
+// benchmark.
+std::optional<Timings> read_timings(std::string const& path);
+
+// Console reporter that also keeps the timings of the runs it prints.
+class TimingReporter : public benchmark::ConsoleReporter
+{
+  public:
+    void ReportRuns(std::vector<Run> const& reports) override;
+
+    [[nodiscard]] Timings const& get_timings() const noexcept;
+
+  private:
+    Timings timings_;
+};
+
+inline Timings const& TimingReporter::get_timings() const noexcept
+{
+    return timings_;
+}
+
+// Prints the change of every benchmark in both current and baseline and
+// returns how many got slower by more than threshold percent.
+std::size_t compare(Timings const& baseline, Timings const& current,
+                    double threshold);
+
+} // namespace chip8::bench
+
+#endif // CHIP_8_BENCH
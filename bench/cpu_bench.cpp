@@ -0,0 +1,129 @@
+// Fetch, decode and execute cost of every class of opcodes.
+//
+// Each benchmark loads a short program made of instructions of one class and
+// ending with a jump back to its start, then runs it through Cpu::run. The
+// items processed are instructions, so the reported rate is the IPS reached
+// on that class alone.
+
+#include "constants.hpp"
+#include "cpu.hpp"
+#include "display.hpp"
+#include "headless_manager.hpp"
+#include "memory.hpp"
+
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <vector>
+
+namespace
+{
+
+// NOLINTNEXTLINE(google-build-using-namespace)
+using namespace chip8;
+
+// Instructions executed by every call to Cpu::run.
+constexpr uint64_t cycles_per_run = 1024;
+
+// Serializes the opcodes big endian, as they are stored in memory.
+std::vector<uint8_t> assemble(std::vector<uint16_t> const& opcodes)
+{
+    std::vector<uint8_t> bytes;
+    bytes.reserve(opcodes.size() * memory::instruction_size);
+    for (const auto opcode : opcodes)
+    {
+        bytes.push_back(static_cast<uint8_t>(opcode >> memory::byte));
+        bytes.push_back(static_cast<uint8_t>(opcode));
+    }
+    return bytes;
+}
+
+// NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+
+// Jumps to itself.
+const std::vector<uint16_t> jump_program{0x1200};
+
+// Loads, arithmetic and logic on the registers.
+const std::vector<uint16_t> alu_program{
+    0x6005, 0x6103, 0x7001, 0x8010, 0x8011, 0x8012, 0x8013,
+    0x8014, 0x8015, 0x8016, 0x8017, 0x801e, 0x1200};
+
+// Conditional skips, half of them taken.
+const std::vector<uint16_t> skip_program{
+    0x6000, 0x6101, 0x3000, 0x6000, 0x3001, 0x4000, 0x4001, 0x6000,
+    0x5010, 0x9010, 0x6000, 0x1200};
+
+// Subroutine call and return.
+const std::vector<uint16_t> call_program{0x2204, 0x1200, 0x00ee};
+
+// 8x5 font sprites drawn at the top left corner.
+const std::vector<uint16_t> draw_program{0x6000, 0x6100, 0xa050,
+                                         0xd015, 0xd015, 0x1206};
+
+// Index register, BCD and register dumps to and from memory.
+const std::vector<uint16_t> memory_program{
+    0x60fe, 0xa300, 0xf01e, 0xf033, 0xf355, 0xa300, 0xf365, 0xf029, 0x1200};
+
+// Timers, random numbers and key checks.
+const std::vector<uint16_t> misc_program{
+    0xf015, 0xf018, 0xf007, 0xc0ff, 0x6000, 0xe09e, 0xe0a1, 0x6000, 0x1200};
+
+// Random numbers alone, masked in every way Cxkk is commonly used.
+const std::vector<uint16_t> random_program{0xc0ff, 0xc101, 0xc23f,
+                                           0xc31f, 0xc4f0, 0x1200};
+
+// NOLINTEND(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+
+void BM_Cpu(benchmark::State& state, std::vector<uint16_t> const& program,
+            CpuBackend backend)
+{
+    HeadlessManager io;
+    Cpu cpu(&io, backend);
+
+    auto rom = assemble(program);
+    cpu.get_memory().load(rom);
+    cpu.invalidate(memory::free_address, static_cast<uint16_t>(rom.size()));
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(cpu.run(cycles_per_run));
+    }
+    benchmark::DoNotOptimize(cpu.get_display().get_framebuffer());
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                            static_cast<int64_t>(cycles_per_run));
+}
+
+} // namespace
+
+// NOLINTBEGIN(cppcoreguidelines-avoid-non-const-global-variables,
+//             cppcoreguidelines-owning-memory)
+
+BENCHMARK_CAPTURE(BM_Cpu, jump, jump_program, CpuBackend::INTERPRETER);
+BENCHMARK_CAPTURE(BM_Cpu, alu, alu_program, CpuBackend::INTERPRETER);
+BENCHMARK_CAPTURE(BM_Cpu, skip, skip_program, CpuBackend::INTERPRETER);
+BENCHMARK_CAPTURE(BM_Cpu, call, call_program, CpuBackend::INTERPRETER);
+BENCHMARK_CAPTURE(BM_Cpu, draw, draw_program, CpuBackend::INTERPRETER);
+BENCHMARK_CAPTURE(BM_Cpu, memory, memory_program, CpuBackend::INTERPRETER);
+BENCHMARK_CAPTURE(BM_Cpu, misc, misc_program, CpuBackend::INTERPRETER);
+BENCHMARK_CAPTURE(BM_Cpu, random, random_program, CpuBackend::INTERPRETER);
+
+BENCHMARK_CAPTURE(BM_Cpu, jump_blocks, jump_program, CpuBackend::BLOCKS);
+BENCHMARK_CAPTURE(BM_Cpu, alu_blocks, alu_program, CpuBackend::BLOCKS);
+BENCHMARK_CAPTURE(BM_Cpu, skip_blocks, skip_program, CpuBackend::BLOCKS);
+BENCHMARK_CAPTURE(BM_Cpu, call_blocks, call_program, CpuBackend::BLOCKS);
+BENCHMARK_CAPTURE(BM_Cpu, draw_blocks, draw_program, CpuBackend::BLOCKS);
+BENCHMARK_CAPTURE(BM_Cpu, memory_blocks, memory_program, CpuBackend::BLOCKS);
+BENCHMARK_CAPTURE(BM_Cpu, misc_blocks, misc_program, CpuBackend::BLOCKS);
+BENCHMARK_CAPTURE(BM_Cpu, random_blocks, random_program, CpuBackend::BLOCKS);
+
+BENCHMARK_CAPTURE(BM_Cpu, jump_jit, jump_program, CpuBackend::JIT);
+BENCHMARK_CAPTURE(BM_Cpu, alu_jit, alu_program, CpuBackend::JIT);
+BENCHMARK_CAPTURE(BM_Cpu, skip_jit, skip_program, CpuBackend::JIT);
+BENCHMARK_CAPTURE(BM_Cpu, call_jit, call_program, CpuBackend::JIT);
+BENCHMARK_CAPTURE(BM_Cpu, draw_jit, draw_program, CpuBackend::JIT);
+BENCHMARK_CAPTURE(BM_Cpu, memory_jit, memory_program, CpuBackend::JIT);
+BENCHMARK_CAPTURE(BM_Cpu, misc_jit, misc_program, CpuBackend::JIT);
+BENCHMARK_CAPTURE(BM_Cpu, random_jit, random_program, CpuBackend::JIT);
+
+// NOLINTEND(cppcoreguidelines-avoid-non-const-global-variables,
+//           cppcoreguidelines-owning-memory)
@@ -0,0 +1,155 @@
+// Cost of the framebuffer operations: sprite drawing, clearing and the
+// conversion to the SDL texture done by Sdl2Manager::render.
+
+#include "constants.hpp"
+#include "display.hpp"
+#include "framebuffer.hpp"
+#include "headless_manager.hpp"
+#include "machine_state.hpp"
+#include "sdl2manager.hpp"
+
+#include <SDL2/SDL.h>
+#include <array>
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <span>
+
+namespace
+{
+
+// NOLINTNEXTLINE(google-build-using-namespace)
+using namespace chip8;
+
+// Tallest sprite Dxyn can draw.
+constexpr uint8_t max_sprite_height = 15;
+
+// NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers,
+//             readability-magic-numbers)
+constexpr std::array<uint8_t, max_sprite_height> sprite_data{
+    0xff, 0x81, 0xbd, 0xa5, 0xa5, 0xbd, 0x81, 0xff,
+    0x18, 0x3c, 0x7e, 0xff, 0x7e, 0x3c, 0x18};
+
+// Alternating pixels, every texel of the rendered texture changes between
+// two rows.
+constexpr Framebuffer::Row even_row = 0xaaaaaaaaaaaaaaaa;
+constexpr Framebuffer::Row odd_row  = 0x5555555555555555;
+// NOLINTEND(cppcoreguidelines-avoid-magic-numbers,
+//           readability-magic-numbers)
+
+// Draws a sprite of range(0) rows at (range(1), range(2)). Every sprite is
+// drawn twice, so that the framebuffer is back to its initial content at the
+// end of each iteration.
+template <SpriteEdge Edge>
+void draw_sprites(benchmark::State& state)
+{
+    HeadlessManager io;
+    MachineState machine;
+    Display display(&io, &machine);
+
+    const auto sprite =
+        std::span(sprite_data).first(static_cast<std::size_t>(state.range(0)));
+    const auto x = static_cast<uint8_t>(state.range(1));
+    const auto y = static_cast<uint8_t>(state.range(2));
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(display.draw<Edge>(x, y, sprite));
+        benchmark::DoNotOptimize(display.draw<Edge>(x, y, sprite));
+    }
+    benchmark::DoNotOptimize(display.get_framebuffer());
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * 2);
+}
+
+void BM_DisplayDraw(benchmark::State& state)
+{
+    draw_sprites<SpriteEdge::CLIP>(state);
+}
+
+// Same, wrapping the sprites around the edges as XO-CHIP does.
+void BM_DisplayDrawWrap(benchmark::State& state)
+{
+    draw_sprites<SpriteEdge::WRAP>(state);
+}
+
+void BM_DisplayClear(benchmark::State& state)
+{
+    HeadlessManager io;
+    MachineState machine;
+    Display display(&io, &machine);
+
+    for (auto _ : state)
+    {
+        display.clear();
+        benchmark::DoNotOptimize(display.get_framebuffer());
+    }
+}
+
+// Converts a checkerboard framebuffer to the window texture. The video and
+// audio drivers default to SDL's dummy drivers and the renderer to the
+// software one, so this runs on hosts without a display too; setting the
+// SDL_VIDEODRIVER and SDL_RENDER_DRIVER variables measures a real backend.
+void BM_Sdl2ManagerRender(benchmark::State& state)
+{
+    SDL_SetHintWithPriority(SDL_HINT_VIDEODRIVER, "dummy", SDL_HINT_DEFAULT);
+    SDL_SetHintWithPriority(SDL_HINT_AUDIODRIVER, "dummy", SDL_HINT_DEFAULT);
+    SDL_SetHintWithPriority(SDL_HINT_RENDER_DRIVER, "software",
+                            SDL_HINT_DEFAULT);
+
+    Sdl2Manager io;
+    if (!io.start())
+    {
+        state.SkipWithError("SDL could not be initialized");
+        return;
+    }
+
+    Framebuffer framebuffer;
+    for (std::size_t y = 0; y < framebuffer.rows.size(); ++y)
+    {
+        framebuffer.rows[y] = y % 2 == 0 ? even_row : odd_row;
+    }
+
+    for (auto _ : state)
+    {
+        io.render(framebuffer);
+    }
+
+    io.stop();
+}
+
+} // namespace
+
+// NOLINTBEGIN(cppcoreguidelines-avoid-non-const-global-variables,
+//             cppcoreguidelines-owning-memory,
+//             cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+
+BENCHMARK(BM_DisplayDraw)
+    ->ArgNames({"height", "x", "y"})
+    // Fully visible sprites of increasing height.
+    ->Args({1, 8, 8})
+    ->Args({5, 8, 8})
+    ->Args({max_sprite_height, 8, 8})
+    // Clipped at the right, bottom and left edges and at the bottom right
+    // corner.
+    ->Args({max_sprite_height, 60, 8})
+    ->Args({max_sprite_height, 8, 28})
+    ->Args({max_sprite_height, 252, 8})
+    ->Args({max_sprite_height, 60, 28})
+    // Entirely off screen.
+    ->Args({max_sprite_height, 200, 8});
+
+BENCHMARK(BM_DisplayDrawWrap)
+    ->ArgNames({"height", "x", "y"})
+    ->Args({max_sprite_height, 8, 8})
+    // Wrapped around the right and bottom edges and the bottom right corner.
+    ->Args({max_sprite_height, 60, 8})
+    ->Args({max_sprite_height, 8, 28})
+    ->Args({max_sprite_height, 60, 28});
+
+BENCHMARK(BM_DisplayClear);
+
+BENCHMARK(BM_Sdl2ManagerRender);
+
+// NOLINTEND(cppcoreguidelines-avoid-non-const-global-variables,
+//           cppcoreguidelines-owning-memory,
+//           cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
@@ -0,0 +1,90 @@
+// chip8-bench: micro and macro benchmarks of the emulator.
+//
+// Besides the flags of Google Benchmark (--benchmark_filter,
+// --benchmark_out=<file> to write the results as JSON, ...) it takes the
+// ROMs to run as macro benchmarks and --baseline, the JSON results of a
+// previous run: every benchmark is then compared with it and the exit status
+// is non-zero if any of them got slower by more than --threshold percent.
+
+#include "bench.hpp"
+
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cxxopts.hpp>
+#include <iostream>
+#include <optional>
+#include <print>
+#include <string>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+    benchmark::Initialize(&argc, argv);
+
+    cxxopts::Options options("chip8-bench",
+                             "Micro and macro benchmarks of the emulator");
+
+    // clang-format off
+    options.add_options()
+        ("baseline", "JSON results of a previous run to compare against",
+            cxxopts::value<std::string>())
+        ("threshold", "Slowdown in percent reported as a regression",
+            cxxopts::value<double>()->default_value("10"))
+        ("c,cycles", "Instructions executed by every ROM benchmark",
+            cxxopts::value<uint64_t>()->default_value("1000000"))
+        ("roms", "ROMs to run as macro benchmarks",
+            cxxopts::value<std::vector<std::string>>());
+    // clang-format on
+
+    options.parse_positional({"roms"});
+    options.positional_help("[<rom>...]");
+
+    std::optional<chip8::bench::Timings> baseline;
+    double threshold = 0.0;
+    try
+    {
+        auto result = options.parse(argc, argv);
+
+        const auto cycles = result["cycles"].as<uint64_t>();
+        if (cycles == 0)
+        {
+            std::println(std::cerr, "Error: the cycle budget must not be 0");
+            return EXIT_FAILURE;
+        }
+
+        if (result.contains("roms"))
+        {
+            const auto roms = result["roms"].as<std::vector<std::string>>();
+            chip8::bench::register_rom_benchmarks(roms, cycles);
+        }
+
+        // Read before running, so that a wrong path does not waste a run.
+        if (result.contains("baseline"))
+        {
+            baseline = chip8::bench::read_timings(
+                result["baseline"].as<std::string>());
+            if (!baseline)
+            {
+                return EXIT_FAILURE;
+            }
+        }
+        threshold = result["threshold"].as<double>();
+    }
+    catch (const std::exception& e)
+    {
+        std::println(std::cerr, "Error parsing arguments: {}", e.what());
+        return EXIT_FAILURE;
+    }
+
+    chip8::bench::TimingReporter reporter;
+    benchmark::RunSpecifiedBenchmarks(&reporter);
+    benchmark::Shutdown();
+
+    if (baseline && chip8::bench::compare(*baseline, reporter.get_timings(),
+                                          threshold) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,68 @@
+// Cost of copying a ROM into memory and of cloning the whole machine.
+
+#include "constants.hpp"
+#include "machine_state.hpp"
+#include "memory.hpp"
+
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+namespace
+{
+
+// NOLINTNEXTLINE(google-build-using-namespace)
+using namespace chip8;
+
+// Loads a ROM of range(0) bytes.
+void BM_MemoryLoad(benchmark::State& state)
+{
+    MachineState machine;
+    Memory mem(&machine);
+    std::vector<uint8_t> rom(static_cast<std::size_t>(state.range(0)));
+    std::iota(rom.begin(), rom.end(), uint8_t{0});
+
+    for (auto _ : state)
+    {
+        mem.load(rom);
+        benchmark::DoNotOptimize(mem.get_data());
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                            state.range(0));
+}
+
+// Copies a whole machine, as forking an emulator does.
+void BM_MachineStateCopy(benchmark::State& state)
+{
+    const MachineState source;
+    MachineState copy;
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(source);
+        copy = source;
+        benchmark::DoNotOptimize(copy);
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                            static_cast<int64_t>(sizeof(MachineState)));
+}
+
+} // namespace
+
+// NOLINTBEGIN(cppcoreguidelines-avoid-non-const-global-variables,
+//             cppcoreguidelines-owning-memory,
+//             cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+
+BENCHMARK(BM_MemoryLoad)
+    ->ArgName("size")
+    ->Arg(256)
+    ->Arg(1024)
+    ->Arg(memory::rom_max_size);
+BENCHMARK(BM_MachineStateCopy);
+
+// NOLINTEND(cppcoreguidelines-avoid-non-const-global-variables,
+//           cppcoreguidelines-owning-memory,
+//           cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
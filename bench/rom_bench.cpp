@@ -0,0 +1,185 @@
+// Macro benchmarks: whole ROMs run through the emulator loop.
+
+#include "bench.hpp"
+
+#include "chip8.hpp"
+#include "constants.hpp"
+#include "cpu.hpp"
+#include "fork_pool.hpp"
+#include "headless_manager.hpp"
+#include "keypad.hpp"
+#include "rom_store.hpp"
+#include "vector_engine.hpp"
+
+#include <algorithm>
+#include <array>
+#include <benchmark/benchmark.h>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace chip8::bench
+{
+
+namespace
+{
+
+// Only sets how often the timers tick, the ROMs run in turbo mode.
+constexpr uint32_t rate = 500;
+
+// Every iteration restores the state the ROM had right after loading, so
+// that all of them run the same instructions. The decoded and compiled code
+// is kept between iterations, as it would be in a long run.
+void run_rom(benchmark::State& state, std::string const& rom, uint64_t cycles,
+             CpuBackend backend)
+{
+    Chip8 chip8(std::make_unique<HeadlessManager>(), rate, backend);
+    if (!chip8.load_rom(rom))
+    {
+        state.SkipWithError("the ROM cannot be loaded");
+        return;
+    }
+    const auto initial = chip8.save_state();
+
+    uint64_t executed = 0;
+    for (auto _ : state)
+    {
+        if (!chip8.load_state(initial))
+        {
+            state.SkipWithError("the initial state cannot be restored");
+            break;
+        }
+        executed += chip8.start(RunMode::TURBO, cycles).cycles;
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(executed));
+}
+
+// Loads the ROM from its file, or from a RomStore that has already mapped it
+// as the workers of a batch do.
+void load_rom(benchmark::State& state, std::string const& rom, bool shared)
+{
+    Chip8 chip8(std::make_unique<HeadlessManager>(), rate);
+    RomStore roms;
+
+    for (auto _ : state)
+    {
+        std::expected<void, LoadRomError> res;
+        if (!shared)
+        {
+            res = chip8.load_rom(rom);
+        }
+        else if (const auto data = roms.open(rom))
+        {
+            res = chip8.load_rom(*data);
+        }
+        else
+        {
+            res = std::unexpected(data.error());
+        }
+        if (!res)
+        {
+            state.SkipWithError("the ROM cannot be loaded");
+            break;
+        }
+    }
+}
+
+// Steps the given number of lanes of a VectorEngine, none of them holding a
+// key, by enough frames to execute about cycles instructions per lane. The
+// items are the instructions of all the lanes, to compare with run_rom().
+void run_lockstep(benchmark::State& state, std::string const& rom,
+                  uint64_t cycles, std::size_t lanes)
+{
+    RomStore roms;
+    const auto data = roms.open(rom);
+    VectorEngine engine({.instances = lanes, .rate = rate});
+    if (!data || !engine.load_rom(*data))
+    {
+        state.SkipWithError("the ROM cannot be loaded");
+        return;
+    }
+
+    const uint64_t frames = std::max<uint64_t>(cycles * 60 / rate, 1);
+    const std::vector<KeyMask> keys(lanes, 0);
+    for (auto _ : state)
+    {
+        // Reloading resets the lanes, so that every iteration runs the same
+        // instructions.
+        (void)engine.load_rom(*data);
+        engine.step(frames, keys);
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(
+        state.iterations() * frames * rate / 60 * lanes));
+}
+
+// Branches the ROM as a search does: every iteration forks the machine,
+// restores it and returns the fork to the pool.
+void fork_rom(benchmark::State& state, std::string const& rom)
+{
+    Chip8 chip8(std::make_unique<HeadlessManager>(), rate);
+    if (!chip8.load_rom(rom))
+    {
+        state.SkipWithError("the ROM cannot be loaded");
+        return;
+    }
+    chip8.enable_forks({});
+    // Lets the ROM set up its screen and variables first.
+    chip8.step(timer::fps, 0);
+
+    for (auto _ : state)
+    {
+        const auto fork = chip8.fork();
+        if (!fork)
+        {
+            state.SkipWithError("the machine cannot be forked");
+            break;
+        }
+        chip8.restore(**fork);
+        chip8.release(*fork);
+    }
+}
+
+} // namespace
+
+void register_rom_benchmarks(std::span<const std::string> roms,
+                             uint64_t cycles)
+{
+    constexpr std::array<std::pair<const char*, CpuBackend>, 3> backends{
+        {{"interpreter", CpuBackend::INTERPRETER},
+         {"blocks", CpuBackend::BLOCKS},
+         {"jit", CpuBackend::JIT}}};
+
+    for (auto const& rom : roms)
+    {
+        for (auto const& [name, backend] : backends)
+        {
+            benchmark::RegisterBenchmark(
+                ("BM_Rom/" + rom + "/" + name).c_str(), run_rom, rom, cycles,
+                backend)
+                ->Unit(benchmark::kMillisecond);
+        }
+        for (const std::size_t lanes : {64, 1024})
+        {
+            benchmark::RegisterBenchmark(
+                ("BM_RomLockstep/" + rom + "/" + std::to_string(lanes))
+                    .c_str(),
+                run_lockstep, rom, cycles, lanes)
+                ->Unit(benchmark::kMillisecond);
+        }
+        benchmark::RegisterBenchmark(("BM_RomFork/" + rom).c_str(), fork_rom,
+                                     rom);
+        benchmark::RegisterBenchmark(("BM_RomLoad/" + rom + "/file").c_str(),
+                                     load_rom, rom, false);
+        benchmark::RegisterBenchmark(("BM_RomLoad/" + rom + "/store").c_str(),
+                                     load_rom, rom, true);
+    }
+}
+
+} // namespace chip8::bench
@@ -19,3 +19,21 @@ function(get_version_from_git OUTPUT_VAR)
     
     set(${OUTPUT_VAR} ${GIT_VERSION} PARENT_SCOPE)
 endfunction()
+
+# Compiles ROM ahead of time with chip8-aot and builds TARGET, an emulator
+# executable that runs that ROM through the compiled code.
+function(add_chip8_aot_executable TARGET ROM)
+    get_filename_component(ROM_PATH "${ROM}" ABSOLUTE)
+    set(GENERATED "${CMAKE_CURRENT_BINARY_DIR}/${TARGET}_aot.cpp")
+
+    add_custom_command(
+        OUTPUT ${GENERATED}
+        COMMAND Chip8Emulator_Aot "${ROM_PATH}" -o "${GENERATED}"
+        DEPENDS Chip8Emulator_Aot "${ROM_PATH}"
+        COMMENT "Compiling ROM ${ROM} ahead of time"
+        VERBATIM
+    )
+
+    add_executable(${TARGET} ${GENERATED} "${PROJECT_SOURCE_DIR}/src/main.cpp")
+    target_link_libraries(${TARGET} PRIVATE Chip8Emulator_Core)
+endfunction()
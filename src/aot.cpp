@@ -0,0 +1,97 @@
+#include "aot.hpp"
+
+#include "constants.hpp"
+#include "cpu.hpp"
+#include "decoder.hpp"
+#include "keypad.hpp"
+#include "machine_state.hpp"
+#include "quirks.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace chip8
+{
+
+namespace
+{
+
+std::vector<AotProgram>& registry()
+{
+    static std::vector<AotProgram> programs;
+    return programs;
+}
+
+} // namespace
+
+AotContext::AotContext(Cpu& cpu) noexcept
+    : v{cpu.state_.registers.data()},
+      i{cpu.state_.index},
+      pc{cpu.state_.pc},
+      stack{cpu.state_.stack.data()},
+      sp{cpu.state_.stack_ptr},
+      dt{cpu.state_.delay_timer},
+      st{cpu.state_.sound_timer},
+      cpu_{cpu}
+{
+}
+
+void AotContext::execute(DecodedInstruction const& instr) noexcept
+{
+    cpu_.instr_ = instr;
+    // The generated code implements the default profile.
+    cpu_.execute<quirks::Default>();
+}
+
+bool AotContext::is_key_pressed(uint8_t key) const noexcept
+{
+    return is_pressed(cpu_.state_.keys, key);
+}
+
+bool register_aot_program(AotProgram const& program)
+{
+    registry().push_back(program);
+    return true;
+}
+
+const AotProgram* find_aot_program(std::span<const uint8_t> rom) noexcept
+{
+    const auto& programs = registry();
+    const auto it        = std::ranges::find_if(programs, [rom](const auto& p) {
+        return std::ranges::equal(p.rom, rom);
+    });
+    return it == programs.end() ? nullptr : &*it;
+}
+
+AotRunner::AotRunner(AotProgram const& program) noexcept : program_{program}
+{
+    std::ranges::fill(block_at_, no_block);
+    for (std::size_t i = 0; i < program_.blocks.size(); ++i)
+    {
+        const auto& block        = program_.blocks[i];
+        block_at_[block.address] = static_cast<int16_t>(i);
+
+        const int block_bytes = block.size * memory::instruction_size;
+        max_block_bytes_      = std::max(max_block_bytes_, block_bytes);
+    }
+}
+
+void AotRunner::invalidate(uint16_t address, uint16_t size) noexcept
+{
+    // Only blocks starting at most max_block_bytes_ before the written range
+    // can overlap it.
+    const int first = std::max(0, address - max_block_bytes_ + 1);
+    const int last  = std::min<int>(address + size, memory::size);
+    for (int start = first; start < last; ++start)
+    {
+        const auto* block = find(start);
+        if (block && start + block->size * memory::instruction_size > address)
+        {
+            block_at_[start] = no_block;
+        }
+    }
+}
+
+} // namespace chip8
@@ -0,0 +1,100 @@
+#ifndef CHIP_8_AOT
+#define CHIP_8_AOT
+
+#include "constants.hpp"
+#include "decoder.hpp"
+
+#include <array>
+#include <cstdint>
+#include <span>
+
+namespace chip8
+{
+
+class Cpu;
+
+// Gives the code generated by chip8-aot direct access to the CPU state. The
+// instructions that are not translated inline are forwarded to the CPU
+// handlers through execute().
+class AotContext
+{
+  public:
+    explicit AotContext(Cpu& cpu) noexcept;
+
+    void execute(DecodedInstruction const& instr) noexcept;
+
+    [[nodiscard]] bool is_key_pressed(uint8_t key) const noexcept;
+
+    // NOLINTBEGIN(misc-non-private-member-variables-in-classes)
+    uint8_t* v;
+    uint16_t& i;
+    uint16_t& pc;
+    uint16_t* stack;
+    int8_t& sp;
+    uint8_t& dt;
+    uint8_t& st;
+    // NOLINTEND(misc-non-private-member-variables-in-classes)
+
+  private:
+    Cpu& cpu_;
+};
+
+using AotFunction = void (*)(AotContext&);
+
+// Basic block compiled ahead of time: it starts at address, executes size
+// instructions and leaves the address of the next instruction in the pc.
+struct AotBlock
+{
+    uint16_t address{};
+    uint16_t size{};
+    AotFunction function{};
+};
+
+struct AotProgram
+{
+    std::span<const uint8_t> rom;
+    std::span<const AotBlock> blocks;
+};
+
+// Makes the program available to every Chip8 that loads the same ROM. Called
+// at static initialization time by the code generated by chip8-aot.
+bool register_aot_program(AotProgram const& program);
+
+[[nodiscard]] const AotProgram* find_aot_program(
+    std::span<const uint8_t> rom) noexcept;
+
+// Runtime state of a compiled program loaded in a CPU: maps every address to
+// the block starting there, if any, and disables the blocks whose code gets
+// overwritten so that the CPU falls back to the interpreter for them.
+class AotRunner
+{
+  public:
+    explicit AotRunner(AotProgram const& program) noexcept;
+
+    // The compiled block starting at the given address, nullptr if there is
+    // none, e.g. past the end of memory, where the interpreter wraps the pc.
+    [[nodiscard]] const AotBlock* find(uint16_t address) const noexcept;
+
+    void invalidate(uint16_t address, uint16_t size) noexcept;
+
+  private:
+    static constexpr int16_t no_block = -1;
+
+    AotProgram program_;
+    std::array<int16_t, memory::size> block_at_{};
+    int max_block_bytes_{};
+};
+
+inline const AotBlock* AotRunner::find(uint16_t address) const noexcept
+{
+    if (address >= memory::size)
+    {
+        return nullptr;
+    }
+    const auto index = block_at_[address];
+    return index == no_block ? nullptr : &program_.blocks[index];
+}
+
+} // namespace chip8
+
+#endif // CHIP_8_AOT
@@ -0,0 +1,117 @@
+#include "audio_engine.hpp"
+
+#include "constants.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numbers>
+#include <span>
+
+namespace chip8
+{
+
+namespace
+{
+
+static_assert(std::has_single_bit(audio::wavetable_size));
+
+// The upper bits of the phase index the wavetable.
+constexpr int phase_shift = 32 - std::countr_zero(audio::wavetable_size);
+
+// Fraction of a full period, 2^32, the phase advances by every sample.
+uint32_t to_phase_step(float frequency, int sample_rate) noexcept
+{
+    constexpr double period = 4294967296.0;
+    return static_cast<uint32_t>(
+        std::lround(static_cast<double>(frequency) * period / sample_rate));
+}
+
+} // namespace
+
+AudioEngine::AudioEngine(Config const& config)
+    : events_{config.capacity}, sample_rate_{config.sample_rate},
+      phase_step_{to_phase_step(config.frequency, config.sample_rate)},
+      volume_{config.volume}
+{
+    for (std::size_t i = 0; i < wavetable_.size(); ++i)
+    {
+        wavetable_[i] = static_cast<float>(
+            std::sin(2.0 * std::numbers::pi * static_cast<double>(i) /
+                     static_cast<double>(wavetable_.size())));
+    }
+}
+
+bool AudioEngine::set_sound(bool on, clock::time_point time) noexcept
+{
+    return events_.try_push(AudioEvent{.time = time, .on = on});
+}
+
+void AudioEngine::render(std::span<float> out) noexcept
+{
+    const auto start =
+        clock::now() - std::chrono::duration_cast<clock::duration>(
+                           std::chrono::duration<double>(
+                               static_cast<double>(out.size()) / sample_rate_));
+
+    std::size_t done = 0;
+    for (auto ready = events_.peek(); !ready.empty(); ready = events_.peek())
+    {
+        auto const& event = ready.front();
+        const auto offset = offset_of(event, start, out.size());
+        if (offset == out.size())
+        {
+            break;
+        }
+
+        synthesize(out.subspan(done, offset - std::min(done, offset)));
+        done         = std::max(done, offset);
+        target_gain_ = event.on ? volume_ : 0.0f;
+        events_.consume(1);
+    }
+    synthesize(out.subspan(done));
+}
+
+void AudioEngine::synthesize(std::span<float> out) noexcept
+{
+    if (gain_ == 0.0f && target_gain_ == 0.0f)
+    {
+        std::ranges::fill(out, 0.0f);
+        return;
+    }
+
+    const float ramp_step = volume_ / audio::ramp_samples;
+    for (auto& sample : out)
+    {
+        if (gain_ < target_gain_)
+        {
+            gain_ = std::min(gain_ + ramp_step, target_gain_);
+        }
+        else if (gain_ > target_gain_)
+        {
+            gain_ = std::max(gain_ - ramp_step, target_gain_);
+        }
+        sample = gain_ * wavetable_[phase_ >> phase_shift];
+        phase_ += phase_step_;
+    }
+}
+
+std::size_t AudioEngine::offset_of(AudioEvent const& event,
+                                   clock::time_point start,
+                                   std::size_t size) const noexcept
+{
+    const std::chrono::duration<double> delay = event.time - start;
+    if (delay.count() <= 0.0)
+    {
+        return 0;
+    }
+    const double offset = std::ceil(delay.count() * sample_rate_);
+    return offset >= static_cast<double>(size)
+               ? size
+               : static_cast<std::size_t>(offset);
+}
+
+} // namespace chip8
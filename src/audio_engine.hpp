@@ -0,0 +1,82 @@
+#ifndef CHIP_8_AUDIO_ENGINE
+#define CHIP_8_AUDIO_ENGINE
+
+#include "constants.hpp"
+#include "spsc_ring.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace chip8
+{
+
+struct AudioEvent
+{
+    std::chrono::steady_clock::time_point time{};
+    bool on{false};
+};
+
+struct AudioEngineConfig
+{
+    int sample_rate      = audio::sample_rate;
+    float frequency      = audio::frequency;
+    float volume         = audio::volume;
+    std::size_t capacity = audio::event_capacity;
+};
+
+// Synthesizes the tone of the sound timer. The emulation thread sends when
+// the tone starts and stops as timestamped events over a lock-free queue, the
+// audio thread renders them at the sample they fall on. The tone is read from
+// a wavetable computed once and render() does no allocation nor system call
+// other than reading the clock, so it is safe on a real-time audio thread.
+class AudioEngine
+{
+  public:
+    using Config = AudioEngineConfig;
+
+    explicit AudioEngine(Config const& config = {});
+
+    // Emulation thread. Returns false, and the event is lost, if the audio
+    // thread is not consuming the events.
+    bool set_sound(
+        bool on,
+        std::chrono::steady_clock::time_point time =
+            std::chrono::steady_clock::now()) noexcept;
+
+    // Audio thread. Fills out with the sound of the last out.size() samples
+    // worth of time: the events are played one buffer late, at the same
+    // distance from each other they were sent.
+    void render(std::span<float> out) noexcept;
+
+  private:
+    using clock = std::chrono::steady_clock;
+
+    // Fills out with the tone, following the current gain.
+    void synthesize(std::span<float> out) noexcept;
+
+    // Index of the sample of a buffer of the given size, covering the time
+    // from start, at which the event takes effect. Events before start take
+    // effect at 0, events after the buffer at size.
+    [[nodiscard]] std::size_t offset_of(AudioEvent const& event,
+                                        clock::time_point start,
+                                        std::size_t size) const noexcept;
+
+    std::array<float, audio::wavetable_size> wavetable_{};
+    SpscRing<AudioEvent> events_;
+    int sample_rate_;
+
+    // Audio thread state. The phase is a fixed-point position in the
+    // wavetable, whose upper bits are the index of the sample.
+    uint32_t phase_{0};
+    uint32_t phase_step_;
+    float gain_{0.0f};
+    float target_gain_{0.0f};
+    float volume_;
+};
+
+} // namespace chip8
+
+#endif // CHIP_8_AUDIO_ENGINE
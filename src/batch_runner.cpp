@@ -0,0 +1,170 @@
+#include "batch_runner.hpp"
+
+#include "chip8.hpp"
+#include "framebuffer.hpp"
+#include "headless_manager.hpp"
+#include "rom_store.hpp"
+#include "save_state.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace chip8
+{
+
+namespace
+{
+
+// Job indices owned by one worker. The owner takes from the back, thieves take
+// from the front, so they only contend when a single job is left.
+class WorkQueue
+{
+  public:
+    void push(std::size_t job)
+    {
+        std::scoped_lock lock(mutex_);
+        jobs_.push_back(job);
+    }
+
+    std::optional<std::size_t> pop()
+    {
+        std::scoped_lock lock(mutex_);
+        if (jobs_.empty())
+        {
+            return std::nullopt;
+        }
+        const auto job = jobs_.back();
+        jobs_.pop_back();
+        return job;
+    }
+
+    std::optional<std::size_t> steal()
+    {
+        std::scoped_lock lock(mutex_);
+        if (jobs_.empty())
+        {
+            return std::nullopt;
+        }
+        const auto job = jobs_.front();
+        jobs_.pop_front();
+        return job;
+    }
+
+  private:
+    std::mutex mutex_;
+    std::deque<std::size_t> jobs_;
+};
+
+} // namespace
+
+BatchRunner::BatchRunner(Config config) noexcept : config_{config}
+{
+}
+
+std::vector<BatchResult> BatchRunner::run(std::span<const BatchJob> jobs) const
+{
+    std::vector<BatchResult> results(jobs.size());
+    if (jobs.empty())
+    {
+        return results;
+    }
+
+    const unsigned workers = n_workers(jobs.size());
+    RomStore roms;
+
+    // Jobs are never added once the workers are started, so a worker that
+    // finds every queue empty can exit.
+    std::vector<WorkQueue> queues(workers);
+    for (std::size_t i = 0; i < jobs.size(); ++i)
+    {
+        queues[i % workers].push(i);
+    }
+
+    auto work = [&](unsigned self) {
+        while (true)
+        {
+            auto job = queues[self].pop();
+            for (unsigned k = 1; !job && k < workers; ++k)
+            {
+                job = queues[(self + k) % workers].steal();
+            }
+            if (!job)
+            {
+                return;
+            }
+            results[*job] = run_job(jobs[*job], roms);
+        }
+    };
+
+    {
+        std::vector<std::jthread> threads;
+        threads.reserve(workers - 1);
+        for (unsigned i = 1; i < workers; ++i)
+        {
+            threads.emplace_back(work, i);
+        }
+        work(0);
+    }
+
+    return results;
+}
+
+BatchResult BatchRunner::run_job(BatchJob const& job, RomStore& roms) const
+{
+    assert(job.cycles != 0);
+
+    BatchResult result;
+    result.rom = job.rom;
+
+    Chip8 emulator(std::make_unique<HeadlessManager>(), config_.rate,
+                   config_.backend, config_.profile);
+    emulator.seed(config_.seed);
+
+    const auto rom = roms.open(job.rom);
+    if (!rom)
+    {
+        result.error = rom.error();
+        return result;
+    }
+    if (auto res = emulator.load_rom(*rom); !res)
+    {
+        result.error = res.error();
+        return result;
+    }
+
+    if (!job.state.empty())
+    {
+        if (auto res = emulator.load_state(job.state); !res)
+        {
+            result.state_error = res.error();
+            return result;
+        }
+    }
+
+    const auto stats        = emulator.start(RunMode::TURBO, job.cycles);
+    result.framebuffer_hash = hash(emulator.get_framebuffer());
+    result.cycles           = stats.cycles;
+    result.elapsed          = stats.elapsed;
+    return result;
+}
+
+unsigned BatchRunner::n_workers(std::size_t n_jobs) const noexcept
+{
+    unsigned threads = config_.threads;
+    if (threads == 0)
+    {
+        threads = std::max(1U, std::thread::hardware_concurrency());
+    }
+    return static_cast<unsigned>(std::min<std::size_t>(threads, n_jobs));
+}
+
+} // namespace chip8
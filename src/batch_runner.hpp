@@ -0,0 +1,90 @@
+#ifndef CHIP_8_BATCH_RUNNER
+#define CHIP_8_BATCH_RUNNER
+
+#include "chip8.hpp"
+#include "cpu.hpp"
+#include "quirks.hpp"
+#include "rom_store.hpp"
+#include "save_state.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace chip8
+{
+
+struct BatchJob
+{
+    std::string rom;
+    // Number of instructions to execute, must not be zero.
+    uint64_t cycles{};
+    // Save state restored before running, e.g. to skip the intro of the ROM.
+    // None if empty.
+    std::string state;
+};
+
+struct BatchResult
+{
+    std::string rom;
+    // Set when the ROM or the state could not be loaded, the other fields are
+    // then zero.
+    std::optional<LoadRomError> error;
+    std::optional<StateError> state_error;
+    uint64_t framebuffer_hash{};
+    uint64_t cycles{};
+    std::chrono::duration<double> elapsed{};
+};
+
+struct BatchRunnerConfig
+{
+    // Number of worker threads, zero means one per hardware thread.
+    unsigned threads{0};
+    uint32_t rate{500};
+    CpuBackend backend{CpuBackend::INTERPRETER};
+    Profile profile{Profile::DEFAULT};
+    // Every job draws its random numbers from this seed, so that its result
+    // does not depend on the thread or the order it runs in.
+    uint64_t seed{0};
+};
+
+// Runs many ROMs headless and in turbo mode, each one on its own Chip8
+// instance. The jobs are spread over a pool of worker threads: every worker
+// owns a queue, pops jobs from its back and, once it is empty, steals from
+// the front of the other queues, so that long jobs do not leave the other
+// cores idle. Instances share no mutable state, a worker only writes the
+// result slot of the job it is running. The ROMs are mapped once in a shared
+// RomStore, so many jobs running the same ROM cost a single read of the file.
+class BatchRunner
+{
+  public:
+    using Config = BatchRunnerConfig;
+
+    explicit BatchRunner(Config config = {}) noexcept;
+
+    [[nodiscard]] Config get_config() const noexcept;
+
+    // Runs all the jobs and returns their results in the same order.
+    [[nodiscard]] std::vector<BatchResult> run(
+        std::span<const BatchJob> jobs) const;
+
+  private:
+    [[nodiscard]] BatchResult run_job(BatchJob const& job,
+                                      RomStore& roms) const;
+
+    [[nodiscard]] unsigned n_workers(std::size_t n_jobs) const noexcept;
+
+    Config config_;
+};
+
+inline BatchRunner::Config BatchRunner::get_config() const noexcept
+{
+    return config_;
+}
+
+} // namespace chip8
+
+#endif // CHIP_8_BATCH_RUNNER
@@ -0,0 +1,116 @@
+#include "block_cache.hpp"
+
+#include "constants.hpp"
+#include "decoder.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace chip8
+{
+
+bool ends_block(Op op) noexcept
+{
+    switch (op)
+    {
+    case Op::RET:
+    case Op::JP_NNN:
+    case Op::CALL:
+    case Op::SE_VX_NN:
+    case Op::SNE_VX_NN:
+    case Op::SE_VX_VY:
+    case Op::SNE_VX_VY:
+    case Op::JP_V0_NNN:
+    case Op::DRW_VX_VY_N:
+    case Op::SKP_VX:
+    case Op::NSKP_VX:
+    case Op::LD_VX_DT:
+    case Op::LD_VX_K:
+    case Op::LD_B_VX:
+    case Op::LD_I_VX:
+    case Op::EMPTY:
+    case Op::UNKNOWN:
+    case Op::SYS_ADDR:
+    case Op::UNDECODED:
+        return true;
+    default:
+        return false;
+    }
+}
+
+std::span<const DecodedInstruction> BlockCache::lookup(
+    uint16_t address, std::array<uint8_t, memory::size> const& mem) noexcept
+{
+    if (address >= memory::size)
+    {
+        return {};
+    }
+
+    const auto& block = blocks_[address];
+    if (block.valid)
+    {
+        return std::span{arena_}.subspan(block.offset, block.size);
+    }
+    return translate(address, mem);
+}
+
+void BlockCache::invalidate(uint16_t address, uint16_t size) noexcept
+{
+    // Only blocks starting at most blocks::max_size instructions before the
+    // written range can overlap it.
+    constexpr int max_block_bytes =
+        blocks::max_size * memory::instruction_size;
+
+    const int first = std::max(0, address - max_block_bytes + 1);
+    const int last  = std::min<int>(address + size, memory::size);
+    for (int start = first; start < last; ++start)
+    {
+        auto& block = blocks_[start];
+        const int end = start + block.size * memory::instruction_size;
+        if (block.valid && end > address)
+        {
+            block.valid = false;
+        }
+    }
+}
+
+void BlockCache::clear() noexcept
+{
+    std::ranges::fill(blocks_, Block{});
+    arena_used_ = 0;
+}
+
+std::span<const DecodedInstruction> BlockCache::translate(
+    uint16_t address, std::array<uint8_t, memory::size> const& mem) noexcept
+{
+    if (arena_used_ + blocks::max_size > arena_.size())
+    {
+        clear();
+    }
+
+    const auto offset = arena_used_;
+    uint8_t size      = 0;
+    for (auto pc = address; pc + 1 < memory::size && size < blocks::max_size;
+         pc += memory::instruction_size)
+    {
+        // NOLINTNEXTLINE(hicpp-signed-bitwise)
+        const uint16_t opcode = (mem[pc] << memory::byte) | mem[pc + 1];
+        const auto instr      = decode(opcode);
+        arena_[offset + size++] = instr;
+        if (ends_block(instr.op))
+        {
+            break;
+        }
+    }
+    arena_used_ += size;
+
+    blocks_[address] = Block{.offset = static_cast<uint16_t>(offset),
+                             .size   = size,
+                             .valid  = true};
+    return std::span{arena_}.subspan(offset, size);
+}
+
+} // namespace chip8
@@ -0,0 +1,59 @@
+#ifndef CHIP_8_BLOCK_CACHE
+#define CHIP_8_BLOCK_CACHE
+
+#include "constants.hpp"
+#include "decoder.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace chip8
+{
+
+// Whether a block ends with the instruction: it can change the control flow
+// (jumps, calls, returns and skips), draws on the display, waits for a key,
+// reads the delay timer, writes to memory or is not a valid instruction.
+[[nodiscard]] bool ends_block(Op op) noexcept;
+
+// Translates the basic blocks of the program into sequences of decoded
+// instructions stored in a fixed-size arena, so that the CPU can execute a
+// whole block without fetching and decoding each instruction. A block ends
+// at the first instruction for which ends_block() holds.
+class BlockCache
+{
+  public:
+    // Returns the block starting at the given address, translating it if it is
+    // not cached yet. The block is empty if the address is past the end of
+    // memory or holds no complete instruction.
+    [[nodiscard]] std::span<const DecodedInstruction> lookup(
+        uint16_t address,
+        std::array<uint8_t, memory::size> const& mem) noexcept;
+
+    // Drops all the blocks overlapping the given memory range.
+    void invalidate(uint16_t address, uint16_t size) noexcept;
+
+    void clear() noexcept;
+
+  private:
+    struct Block
+    {
+        uint16_t offset{};
+        uint8_t size{};
+        bool valid{false};
+    };
+
+    std::span<const DecodedInstruction> translate(
+        uint16_t address,
+        std::array<uint8_t, memory::size> const& mem) noexcept;
+
+    std::array<Block, memory::size> blocks_{};
+
+    std::array<DecodedInstruction, blocks::arena_size> arena_{};
+    std::size_t arena_used_{};
+};
+
+} // namespace chip8
+
+#endif // CHIP_8_BLOCK_CACHE
@@ -1,32 +1,53 @@
 #include "chip8.hpp"
 
+#include "aot.hpp"
 #include "constants.hpp"
 #include "cpu.hpp"
 #include "display.hpp"
+#include "fork_pool.hpp"
 #include "io_manager.hpp"
 #include "memory.hpp"
+#include "op_stats.hpp"
+#include "recording.hpp"
+#include "rewind.hpp"
+#include "rom_store.hpp"
+#include "save_state.hpp"
+#include "trace.hpp"
+#include "utility.hpp"
 
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <expected>
-#include <fstream>
 #include <iostream>
 #include <memory>
+#include <random>
+#include <print>
+#include <span>
 #include <string>
-#include <thread>
-#include <vector>
 
 namespace chip8
 {
 
-Chip8::Chip8(std::unique_ptr<IOManager> io, uint16_t rate)
+double RunStats::ips() const noexcept
+{
+    if (elapsed.count() <= 0.0)
+    {
+        return 0.0;
+    }
+    return static_cast<double>(cycles) / elapsed.count();
+}
+
+Chip8::Chip8(std::unique_ptr<IOManager> io, uint32_t rate,
+             CpuBackend backend, Profile profile)
     : io_{std::move(io)},
-      mem_{std::make_unique<Memory>()},
-      display_{std::make_unique<Display>(io_.get())},
-      cpu_{std::make_unique<Cpu>(io_.get(), mem_.get(), display_.get())},
+      cpu_{std::make_unique<Cpu>(io_.get(), backend, profile)},
       cpu_rate_{rate}
 {
+    seed(std::random_device{}());
 }
 
 Chip8::Chip8(Chip8&&) noexcept = default;
@@ -35,99 +56,579 @@ Chip8::~Chip8() = default;
 
 Chip8& Chip8::operator=(Chip8&&) noexcept = default;
 
+void Chip8::seed(uint64_t seed) noexcept
+{
+    cpu_->seed_random(seed);
+}
+
 std::expected<void, LoadRomError> Chip8::load_rom(std::string const& path)
 {
-    assert(!running_);
+    const auto mapping = map_rom(path);
+    if (!mapping)
+    {
+        return std::unexpected(mapping.error());
+    }
 
-    if (std::ifstream file(path, std::ios::binary | std::ios::ate);
-        file.is_open())
+    if (auto res = load_rom(mapping->data()); !res)
     {
-        auto size = file.tellg();
-        if (size == 0)
-        {
-            return std::unexpected(LoadRomError::ROM_EMPTY);
-        }
-        if (size > memory::rom_max_size)
-        {
-            return std::unexpected(LoadRomError::ROM_TOO_BIG);
-        }
+        return res;
+    }
+    state_path_ = path + ".state";
 
-        std::vector<uint8_t> buffer(size);
-        file.seekg(0, std::ios::beg);
-        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-        auto* char_buffer = reinterpret_cast<char*>(buffer.data());
-        file.read(char_buffer, size);
+    return {};
+}
+
+std::expected<void, LoadRomError> Chip8::load_rom(std::span<const uint8_t> rom)
+{
+    assert(!running_);
+
+    if (auto res = validate_rom(rom); !res)
+    {
+        return res;
+    }
 
-        mem_->load(buffer);
+    cpu_->get_memory().load(rom);
+    cpu_->invalidate(memory::free_address, rom.size());
 
-        rom_loaded_ = true;
+    if (const auto* program = find_aot_program(rom))
+    {
+        cpu_->attach(*program);
     }
-    else
+
+    if (rewind_)
     {
-        return std::unexpected(LoadRomError::FILE_NOT_FOUND);
+        rewind_->clear();
     }
 
+    frames_       = 0;
+    instructions_ = 0;
+
+    rom_loaded_ = true;
+    state_path_.clear();
+
     return {};
 }
 
-void Chip8::start()
+RunStats Chip8::start(RunMode mode, uint64_t cycle_budget)
 {
     assert(rom_loaded_);
     assert(!running_);
 
     io_->start();
 
+    RunStats stats;
+    const auto start_time = std::chrono::steady_clock::now();
+
+    if (replay_)
+    {
+        seek(replay_from_);
+    }
+
     running_ = true;
-    run_main_loop();
+    switch (mode)
+    {
+    case RunMode::PACED:
+        run_main_loop(cycle_budget, stats);
+        break;
+    case RunMode::TURBO:
+        run_turbo_loop(cycle_budget, stats);
+        break;
+    }
+
+    stats.elapsed = std::chrono::steady_clock::now() - start_time;
+
+    if (recorder_)
+    {
+        const auto state = save_state();
+        recorder_->finish(
+            RecordingEnd{.frame            = frames_,
+                         .instruction      = instructions_,
+                         .framebuffer_hash = hash(state.framebuffer),
+                         .state_hash       = hash(state)});
+        recorder_.reset();
+    }
+
+    return stats;
+}
+
+const Framebuffer& Chip8::get_framebuffer() const noexcept
+{
+    return cpu_->get_display().get_framebuffer();
+}
+
+SaveState Chip8::save_state() const noexcept
+{
+    SaveState state;
+    state.framebuffer = cpu_->get_display().get_framebuffer();
+    state.memory      = cpu_->get_memory().get_data();
+    cpu_->save_state(state.cpu);
+    return state;
+}
+
+std::expected<void, StateError> Chip8::load_state(SaveState const& state)
+{
+    if (auto res = validate(state); !res)
+    {
+        return std::unexpected(res.error());
+    }
+
+    apply_state(state);
+    if (rewind_)
+    {
+        rewind_->clear();
+    }
+
+    rom_loaded_ = true;
+
+    return {};
 }
 
-void Chip8::run_main_loop()
+void Chip8::enable_rewind(RewindConfig const& config)
 {
-    using namespace std::chrono_literals;
+    rewind_ = std::make_unique<RewindBuffer>(config);
+    cpu_->set_rewind_buffer(rewind_.get());
+    cpu_->get_display().set_rewind_buffer(rewind_.get());
+}
+
+std::size_t Chip8::rewind(std::size_t frames)
+{
+    if (!rewind_)
+    {
+        return 0;
+    }
+
+    auto state         = save_state();
+    const auto rewound = rewind_->rewind(frames, state);
+    apply_state(state);
+    return rewound;
+}
+
+void Chip8::enable_forks(ForkPoolConfig const& config)
+{
+    forks_ = std::make_unique<ForkPool>(config);
+}
+
+std::expected<Fork const*, ForkError> Chip8::fork()
+{
+    if (!forks_)
+    {
+        return std::unexpected(ForkError::DISABLED);
+    }
+    if (!rom_loaded_)
+    {
+        return std::unexpected(ForkError::NO_ROM);
+    }
+
+    auto* slot = forks_->acquire();
+    if (!slot)
+    {
+        return std::unexpected(ForkError::POOL_EXHAUSTED);
+    }
+    slot->machine      = cpu_->get_state();
+    slot->frames       = frames_;
+    slot->instructions = instructions_;
+
+    return slot;
+}
+
+void Chip8::restore(Fork const& fork)
+{
+    invalidate_changes(fork.machine.memory);
+    cpu_->get_state() = fork.machine;
+    // Makes the restored screen be presented.
+    cpu_->get_display().load_framebuffer(fork.machine.framebuffer);
+
+    frames_       = fork.frames;
+    instructions_ = fork.instructions;
+
+    if (rewind_)
+    {
+        rewind_->clear();
+    }
+
+    rom_loaded_ = true;
+}
+
+void Chip8::release(Fork const* fork) noexcept
+{
+    assert(forks_);
+    forks_->release(fork);
+}
+
+uint64_t Chip8::step(uint64_t n_frames, KeyMask keys)
+{
+    assert(rom_loaded_);
+
+    uint64_t executed = 0;
+    for (uint64_t frame = 0; frame < n_frames; ++frame)
+    {
+        executed += emulate_frame(cycles_in_frame(frames_), keys);
+    }
+    return executed;
+}
+
+std::expected<void, StateError> Chip8::save_state(
+    std::string const& path) const
+{
+    return write_state(path, save_state());
+}
+
+std::expected<void, StateError> Chip8::load_state(std::string const& path)
+{
+    const auto state = read_state(path);
+    if (!state)
+    {
+        return std::unexpected(state.error());
+    }
+    return load_state(*state);
+}
+
+std::expected<void, RecordingError> Chip8::start_recording(
+    std::string const& path)
+{
+    assert(!running_);
+
+    RecordingHeader header;
+    header.keyframe_interval = recording::keyframe_interval;
+    header.rate              = cpu_rate_;
+    header.profile           = cpu_->get_profile();
+
+    auto recorder = std::make_unique<Recorder>(path, header);
+    if (!recorder->good())
+    {
+        return std::unexpected(RecordingError::WRITE_FAILED);
+    }
+
+    frames_       = 0;
+    instructions_ = 0;
+    if (rewind_)
+    {
+        rewind_->clear();
+    }
+
+    recorder_ = std::move(recorder);
+    replay_.reset();
+
+    return {};
+}
+
+std::expected<void, RecordingError> Chip8::start_replay(
+    std::string const& path, uint64_t from_frame)
+{
+    assert(!running_);
+
+    auto recording = read_recording(path);
+    if (!recording)
+    {
+        return std::unexpected(recording.error());
+    }
+
+    // The frames must have the same length and the instructions the same
+    // behavior they had when recorded.
+    cpu_rate_ = recording->header.rate;
+    cpu_->set_profile(recording->header.profile);
+
+    replay_      = std::make_unique<Replay>(std::move(*recording));
+    replay_from_ = from_frame;
+    recorder_.reset();
+    if (rewind_)
+    {
+        rewind_->clear();
+    }
 
-    using clock    = std::chrono::high_resolution_clock;
-    using duration = std::chrono::duration<double>;
+    rom_loaded_ = true;
+
+    return {};
+}
+
+ReplayResult Chip8::check_replay() const noexcept
+{
+    assert(replay_);
+
+    const auto& end = replay_->get_recording().end;
+    if (!end)
+    {
+        return ReplayResult::UNVERIFIED;
+    }
+
+    const bool match = instructions_ == end->instruction &&
+                       hash(save_state()) == end->state_hash;
+    return match ? ReplayResult::MATCH : ReplayResult::MISMATCH;
+}
+
+void Chip8::enable_op_stats()
+{
+    op_stats_ = std::make_unique<OpStats>();
+    cpu_->set_op_stats(op_stats_.get());
+}
+
+const OpStats* Chip8::get_op_stats() const noexcept
+{
+    return op_stats_.get();
+}
+
+std::expected<void, TraceError> Chip8::start_trace(std::string const& path,
+                                                   TracerConfig const& config)
+{
+    assert(!running_);
+
+    auto tracer = std::make_unique<Tracer>(path, config);
+    if (!tracer->good())
+    {
+        return std::unexpected(TraceError::WRITE_FAILED);
+    }
+
+    cpu_->set_tracer(tracer.get());
+    tracer_ = std::move(tracer);
+
+    return {};
+}
+
+std::expected<uint64_t, TraceError> Chip8::finish_trace()
+{
+    assert(tracer_);
+
+    cpu_->set_tracer(nullptr);
+    const auto tracer = std::move(tracer_);
+    if (!tracer->finish())
+    {
+        return std::unexpected(TraceError::WRITE_FAILED);
+    }
+    return tracer->get_dropped();
+}
+
+void Chip8::run_main_loop(uint64_t cycle_budget, RunStats& stats)
+{
+    using clock = std::chrono::steady_clock;
 
     assert(running_);
 
-    const duration cpu_frame_duration(1.0 / cpu_rate_);
-    auto cpu_accumulator    = duration::zero();
-    auto timers_accumulator = duration::zero();
-    auto prev_time          = clock::now();
+    auto deadline = clock::now();
 
     while (running_)
     {
-        const bool quit = !io_->update();
-        if (quit)
+        if (!run_frame(cycle_budget, stats))
         {
             io_->stop();
             running_ = false;
             continue;
         }
 
-        auto current_time = clock::now();
-        const auto dt     = current_time - prev_time;
+        deadline += timer::frame_period;
+
+        // If the host could not keep up the missed frames are dropped, so that
+        // the emulation does not try to catch up by running them at full speed.
+        const auto now = clock::now();
+        if (now - deadline > loop::max_lag)
+        {
+            deadline = now;
+            continue;
+        }
+
+        utility::sleep_until(deadline);
+    }
+}
+
+void Chip8::run_turbo_loop(uint64_t cycle_budget, RunStats& stats)
+{
+    assert(running_);
+
+    // The emulated time advances by one timer frame every rate / 60
+    // instructions, regardless of the host speed.
+    while (running_)
+    {
+        if (!run_frame(cycle_budget, stats))
+        {
+            io_->stop();
+            running_ = false;
+        }
+    }
+}
+
+bool Chip8::run_frame(uint64_t cycle_budget, RunStats& stats)
+{
+    if (!io_->update())
+    {
+        return false;
+    }
+
+    if (replay_ && instructions_ >= replay_->length())
+    {
+        return false;
+    }
+
+    if (!handle_command(io_->poll_command()))
+    {
+        cpu_->get_display().print();
+        return true;
+    }
+
+    if (rewind_)
+    {
+        record_frame();
+    }
+
+    uint64_t frame_cycles = cycles_in_frame(frames_);
+    if (cycle_budget != 0)
+    {
+        frame_cycles = std::min(frame_cycles, cycle_budget - stats.cycles);
+    }
+    if (replay_)
+    {
+        frame_cycles =
+            std::min(frame_cycles, replay_->length() - instructions_);
+    }
+
+    stats.cycles += emulate_frame(frame_cycles);
+
+    cpu_->get_display().print();
+
+    return cycle_budget == 0 || stats.cycles < cycle_budget;
+}
+
+uint64_t Chip8::emulate_frame(uint64_t max_cycles)
+{
+    if (recorder_ && recorder_->needs_keyframe(frames_))
+    {
+        recorder_->record_keyframe(frames_, instructions_, save_state());
+    }
+
+    const KeyMask keys =
+        replay_ ? replay_->keys_at(instructions_) : io_->get_keys();
+    if (recorder_)
+    {
+        recorder_->record_keys(instructions_, keys);
+    }
+    return emulate_frame(max_cycles, keys);
+}
+
+uint64_t Chip8::emulate_frame(uint64_t max_cycles, KeyMask keys)
+{
+    cpu_->set_keys(keys);
+
+    const auto executed = cpu_->run(max_cycles);
+    instructions_ += executed;
+
+    cpu_->update_timers();
+    ++frames_;
 
-        cpu_accumulator += dt;
-        timers_accumulator += dt;
+    return executed;
+}
 
-        if (timers_accumulator >= timer::frame_duration)
+bool Chip8::handle_command(Command command)
+{
+    switch (command)
+    {
+    case Command::NONE:
+        break;
+    case Command::REWIND:
+        // While rewinding the emulation is suspended.
+        if (rewind_ && !is_deterministic())
+        {
+            rewind(rewind::frames_per_step);
+            return false;
+        }
+        break;
+    case Command::SAVE_STATE:
+        if (auto res = save_state(state_path_); res)
+        {
+            std::println("State saved to {}", state_path_);
+        }
+        else
         {
-            cpu_->update_timers();
-            timers_accumulator -= timer::frame_duration;
+            std::println(std::cerr, "Error: {}", to_string(res.error()));
         }
+        break;
+    case Command::LOAD_STATE:
+        if (is_deterministic())
+        {
+            std::println(std::cerr,
+                         "Error: states cannot be loaded while recording or "
+                         "replaying");
+        }
+        else if (auto res = load_state(state_path_); res)
+        {
+            std::println("State loaded from {}", state_path_);
+        }
+        else
+        {
+            std::println(std::cerr, "Error: {}", to_string(res.error()));
+        }
+        break;
+    }
+    return true;
+}
+
+void Chip8::seek(uint64_t frame)
+{
+    assert(replay_);
+
+    const auto& keyframe = replay_->seek(frame);
+    apply_state(keyframe.state);
+    frames_       = keyframe.frame;
+    instructions_ = keyframe.instruction;
+
+    while (frames_ < frame && instructions_ < replay_->length())
+    {
+        emulate_frame(std::min(cycles_in_frame(frames_),
+                               replay_->length() - instructions_));
+    }
+}
 
-        if (cpu_accumulator >= cpu_frame_duration)
+bool Chip8::is_deterministic() const noexcept
+{
+    return recorder_ || replay_;
+}
+
+void Chip8::apply_state(SaveState const& state)
+{
+    invalidate_changes(state.memory);
+    cpu_->get_memory().get_data() = state.memory;
+
+    cpu_->load_state(state.cpu);
+    cpu_->get_display().load_framebuffer(state.framebuffer);
+}
+
+void Chip8::invalidate_changes(
+    std::array<uint8_t, memory::size> const& content)
+{
+    // Only the memory that actually changes is invalidated, so that restoring
+    // a state of the same ROM keeps most of the decoded and compiled code.
+    const auto& data = cpu_->get_memory().get_data();
+    for (uint16_t address = 0; address < memory::size;
+         address += state::invalidation_chunk)
+    {
+        const auto current =
+            std::span(data).subspan(address, state::invalidation_chunk);
+        const auto restored =
+            std::span(content).subspan(address, state::invalidation_chunk);
+        if (!std::ranges::equal(current, restored))
         {
-            cpu_->tick();
-            display_->print();
-            cpu_accumulator -= cpu_frame_duration;
+            cpu_->invalidate(address, state::invalidation_chunk);
         }
+    }
+}
 
-        prev_time = current_time;
+void Chip8::record_frame()
+{
+    assert(rewind_);
 
-        std::this_thread::sleep_for(loop::duration);
+    if (rewind_->needs_keyframe())
+    {
+        rewind_->begin_frame(save_state());
+        return;
     }
+
+    CpuState cpu;
+    cpu_->save_state(cpu);
+    rewind_->begin_frame(cpu);
+}
+
+uint64_t Chip8::cycles_in_frame(uint64_t frame) const noexcept
+{
+    const uint64_t frame_in_second = frame % timer::fps;
+    return (frame_in_second + 1) * cpu_rate_ / timer::fps -
+           frame_in_second * cpu_rate_ / timer::fps;
 }
 
 } // namespace chip8
@@ -1,28 +1,62 @@
 #ifndef CHIP_8
 #define CHIP_8
 
+#include "cpu.hpp"
+#include "framebuffer.hpp"
+#include "recording.hpp"
+#include "rom_store.hpp"
+#include "save_state.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <expected>
 #include <memory>
+#include <span>
+#include <string>
 
 namespace chip8
 {
 
-class Cpu;
-class Memory;
-class Display;
 class IOManager;
+class ForkPool;
+struct ForkPoolConfig;
+struct Fork;
+enum class ForkError : uint8_t;
+class RewindBuffer;
+struct RewindConfig;
+struct OpStats;
+class Tracer;
+struct TracerConfig;
+enum class TraceError : uint8_t;
+enum class Command : uint8_t;
+
+enum class RunMode : uint8_t
+{
+    // Executes instructions at the configured rate, in real time: every 60 Hz
+    // frame runs rate / 60 instructions in a batch and then sleeps until the
+    // next frame deadline.
+    PACED,
+    // Executes instructions as fast as the host allows, timers are still
+    // updated every rate / 60 instructions to keep the emulated time coherent.
+    TURBO
+};
 
-enum class LoadRomError : uint8_t
+struct RunStats
 {
-    FILE_NOT_FOUND,
-    ROM_EMPTY,
-    ROM_TOO_BIG
+    uint64_t cycles{};
+    std::chrono::duration<double> elapsed{};
+
+    [[nodiscard]] double ips() const noexcept;
 };
 
 class Chip8
 {
   public:
-    Chip8(std::unique_ptr<IOManager> io, uint16_t rate);
+    Chip8(std::unique_ptr<IOManager> io, uint32_t rate,
+          CpuBackend backend = CpuBackend::INTERPRETER,
+          Profile profile = Profile::DEFAULT);
     Chip8(Chip8 const&) = delete;
     Chip8(Chip8&&) noexcept;
 
@@ -31,20 +65,157 @@ class Chip8
     Chip8& operator=(Chip8 const&) = delete;
     Chip8& operator=(Chip8&&) noexcept;
 
+    // Restarts the random numbers drawn by Cxkk from the given seed, so that
+    // runs with the same inputs are identical. A Chip8 is seeded with a
+    // random seed at construction.
+    void seed(uint64_t seed) noexcept;
+
+    // The ROM file is mapped and copied straight to the memory.
     std::expected<void, LoadRomError> load_rom(std::string const& path);
 
-    void start();
+    // Loads a ROM already in memory, e.g. held by a RomStore. There is no file
+    // to name the state after, so the save state hotkeys report an error.
+    std::expected<void, LoadRomError> load_rom(std::span<const uint8_t> rom);
+
+    // Runs the loaded ROM until the IOManager quits or, if cycle_budget is not
+    // zero, until cycle_budget instructions have been executed.
+    RunStats start(RunMode mode = RunMode::PACED, uint64_t cycle_budget = 0);
+
+    [[nodiscard]] const Framebuffer& get_framebuffer() const noexcept;
+
+    // Snapshot of the whole machine, it can be restored any number of times
+    // and on any Chip8 instance.
+    [[nodiscard]] SaveState save_state() const noexcept;
+    std::expected<void, StateError> load_state(SaveState const& state);
+
+    std::expected<void, StateError> save_state(std::string const& path) const;
+    std::expected<void, StateError> load_state(std::string const& path);
+
+    // Starts recording the history needed by rewind(). Loading a ROM or a
+    // state drops the history.
+    void enable_rewind(RewindConfig const& config);
+
+    // Brings the machine back by the given number of frames, as far as the
+    // recorded history allows. Returns the number of frames rewound.
+    std::size_t rewind(std::size_t frames);
+
+    // Makes fork() hand out up to config.capacity forks at the same time, see
+    // ForkPool. The forks obtained before are dropped.
+    void enable_forks(ForkPoolConfig const& config);
+
+    // Copies the emulated machine to a free slot of the fork pool, without
+    // allocating, e.g. to branch it during a search over the inputs. The fork
+    // stays valid until it is given back to release().
+    std::expected<Fork const*, ForkError> fork();
+
+    // Puts the machine back in the state of the fork, which can come from any
+    // Chip8. The fork itself is left untouched and can be restored again.
+    // Like load_state() it drops the rewind history.
+    void restore(Fork const& fork);
+
+    // Returns a fork obtained from this Chip8 to its pool.
+    void release(Fork const* fork) noexcept;
+
+    // Emulates n_frames 60 Hz frames with the given keys held, without
+    // polling the IOManager, presenting the display or recording anything.
+    // Returns the number of instructions executed.
+    uint64_t step(uint64_t n_frames, KeyMask keys);
+
+    // Records the next start() to the given file, see Recorder. The random
+    // generator is saved with the rest of the machine in the keyframes.
+    std::expected<void, RecordingError> start_recording(
+        std::string const& path);
+
+    // Makes the next start() replay the given recording from the given frame.
+    // The recording contains the whole machine, so no ROM needs to be loaded.
+    // The keys pressed by the user are ignored and the rate and the profile
+    // of the recording are used.
+    std::expected<void, RecordingError> start_replay(std::string const& path,
+                                                     uint64_t from_frame = 0);
+
+    // Compares the state reached by the replay with the recorded one.
+    [[nodiscard]] ReplayResult check_replay() const noexcept;
+
+    // Starts counting and timing the executed instructions by Op. Profiling
+    // slows the emulation down, so it is only enabled on request.
+    void enable_op_stats();
+
+    // The stats collected since enable_op_stats(), nullptr if not enabled.
+    [[nodiscard]] const OpStats* get_op_stats() const noexcept;
+
+    // Appends every instruction executed from now on to the given trace file,
+    // until finish_trace().
+    std::expected<void, TraceError> start_trace(std::string const& path,
+                                                TracerConfig const& config);
+
+    // Stops tracing and writes the records still buffered. Returns the number
+    // of records dropped because the file could not be written fast enough.
+    std::expected<uint64_t, TraceError> finish_trace();
 
   private:
-    void run_main_loop();
+    void run_main_loop(uint64_t cycle_budget, RunStats& stats);
+    void run_turbo_loop(uint64_t cycle_budget, RunStats& stats);
+
+    // Runs one 60 Hz frame: polls the IOManager, executes the frame's batch of
+    // instructions, updates the timers and presents the display. Returns false
+    // when the emulation must stop.
+    bool run_frame(uint64_t cycle_budget, RunStats& stats);
+
+    // Executes up to max_cycles instructions of the current frame and ticks
+    // the timers, without polling the IOManager or presenting the display.
+    uint64_t emulate_frame(uint64_t max_cycles);
+    // Same, with the given keys held.
+    uint64_t emulate_frame(uint64_t max_cycles, KeyMask keys);
+
+    // Moves the replay to the given frame, restoring the closest keyframe and
+    // emulating the frames after it.
+    void seek(uint64_t frame);
+
+    // Whether the run must be reproducible, i.e. it is recorded or replayed.
+    [[nodiscard]] bool is_deterministic() const noexcept;
+
+    // Number of instructions to execute in the given frame. The remainder of
+    // rate / 60 is spread over the frames so that exactly rate instructions
+    // are executed every 60 frames.
+    [[nodiscard]] uint64_t cycles_in_frame(uint64_t frame) const noexcept;
+
+    // Returns false when the frame must not be run.
+    bool handle_command(Command command);
+
+    // Restores a validated state without touching the rewind history.
+    void apply_state(SaveState const& state);
+
+    // Invalidates the code in the parts of the memory that differ from the
+    // given content, which is about to be restored.
+    void invalidate_changes(std::array<uint8_t, memory::size> const& content);
+
+    void record_frame();
 
     std::unique_ptr<IOManager> io_;
 
-    std::unique_ptr<Memory> mem_;
-    std::unique_ptr<Display> display_;
+    // Holds the whole machine, memory and display included, in a single
+    // allocation.
     std::unique_ptr<Cpu> cpu_;
 
-    uint16_t cpu_rate_;
+    std::unique_ptr<RewindBuffer> rewind_;
+    std::unique_ptr<ForkPool> forks_;
+    std::unique_ptr<Recorder> recorder_;
+    std::unique_ptr<Replay> replay_;
+    std::unique_ptr<OpStats> op_stats_;
+    std::unique_ptr<Tracer> tracer_;
+
+    uint32_t cpu_rate_;
+
+    // Frames emulated and instructions executed since the ROM was loaded or
+    // the recording, or the replay, started.
+    uint64_t frames_{0};
+    uint64_t instructions_{0};
+
+    // Frame the replay starts from.
+    uint64_t replay_from_{0};
+
+    // Where the save state hotkeys write and read the state of the ROM.
+    std::string state_path_;
 
     bool rom_loaded_{false};
     bool running_{false};
@@ -4,6 +4,7 @@
 #include <array>
 #include <chrono>
 #include <cstdint>
+#include <string_view>
 
 namespace chip8
 {
@@ -13,18 +14,59 @@ namespace loop
 
 using namespace std::chrono_literals;
 
-constexpr auto duration = 100us;
+// How far the paced loop may fall behind its frame deadlines (e.g. after the
+// process was suspended) before it drops the missed frames instead of
+// running them back to back.
+constexpr auto max_lag = 100ms;
 
 } // namespace loop
 
+namespace presenter
+{
+
+using namespace std::chrono_literals;
+
+// How long the presenter thread waits before polling the events again when
+// the emulation has not published a new frame.
+constexpr auto idle_sleep = 1ms;
+
+} // namespace presenter
+
+namespace host
+{
+
+// Alignment that keeps data written by different threads on different cache
+// lines. Not std::hardware_destructive_interference_size, whose value may
+// change between compiler versions and thus break the ABI.
+constexpr std::size_t cache_line = 64;
+
+} // namespace host
+
 namespace timer
 {
 
-constexpr std::size_t fps     = 60;
-constexpr auto frame_duration = std::chrono::duration<double>(1.f / fps);
+constexpr std::size_t fps   = 60;
+constexpr auto frame_period = std::chrono::nanoseconds(1'000'000'000 / fps);
 
 } // namespace timer
 
+namespace audio
+{
+
+constexpr int sample_rate = 44100;
+// Samples per device buffer, the audio latency is about twice its duration.
+constexpr uint16_t buffer_samples = 512;
+constexpr float frequency         = 440.0f;
+constexpr float volume            = 0.2f;
+// Samples in the precomputed period of the tone, a power of two.
+constexpr std::size_t wavetable_size = 1024;
+// Samples over which the tone fades in and out, to avoid clicks.
+constexpr int ramp_samples = 64;
+// Sound events the audio thread has not processed yet.
+constexpr std::size_t event_capacity = 256;
+
+} // namespace audio
+
 namespace cpu
 {
 
@@ -33,6 +75,25 @@ constexpr uint8_t stack_size  = 16;
 
 } // namespace cpu
 
+namespace blocks
+{
+
+constexpr uint8_t max_size       = 32;
+constexpr std::size_t arena_size = 8192;
+
+} // namespace blocks
+
+namespace jit
+{
+
+// Bytes of executable memory shared by the blocks compiled by a Cpu.
+constexpr std::size_t arena_size = 1 << 20;
+// Upper bound of the machine code emitted for one instruction, exit path
+// included, which the arena keeps free before translating a block.
+constexpr std::size_t max_instruction_size = 64;
+
+} // namespace jit
+
 namespace memory
 {
 
@@ -41,6 +102,8 @@ constexpr uint8_t byte = 8;
 constexpr uint16_t size         = 4096;
 constexpr uint16_t font_address = 0x050;
 constexpr uint16_t free_address = 0x200;
+// Addresses wrap around the end of memory: only their low 12 bits are used.
+constexpr uint16_t address_mask = size - 1;
 
 constexpr uint8_t instruction_size = 2;
 
@@ -58,10 +121,66 @@ constexpr uint8_t pixel_scale = 15;
 
 } // namespace display
 
+namespace state
+{
+
+// Granularity of the memory comparison done when a state is restored.
+constexpr uint16_t invalidation_chunk = 64;
+
+} // namespace state
+
+namespace rewind
+{
+
+constexpr uint32_t default_seconds   = 30;
+constexpr uint32_t keyframe_interval = timer::fps;
+// Average memory bytes and framebuffer rows written per frame that the
+// default journal size accounts for.
+constexpr uint32_t journal_entries_per_frame = 32;
+// Frames rewound for every frame the rewind key is held.
+constexpr std::size_t frames_per_step = 2;
+
+} // namespace rewind
+
+namespace fork
+{
+
+// Machines a ForkPool holds by default, about 4.5 MiB.
+constexpr uint32_t default_capacity = 1024;
+
+} // namespace fork
+
+namespace trace
+{
+
+// Records buffered between the emulator and the thread writing the trace,
+// 2 MiB: a few milliseconds of execution in turbo mode.
+constexpr std::size_t ring_capacity = std::size_t{1} << 16;
+// How long the writer thread sleeps when the ring is empty.
+constexpr auto drain_interval = std::chrono::microseconds(500);
+
+} // namespace trace
+
+namespace recording
+{
+
+constexpr uint16_t keyframe_interval = 10 * timer::fps;
+
+} // namespace recording
+
 namespace input
 {
 
-constexpr uint8_t n_keys = 16;
+constexpr uint8_t n_keys  = 16;
+constexpr uint8_t key_mask = 0xf;
+
+// Host keys of the keypad keys 0 to F, the layout of the COSMAC VIP keypad
+// on the left of a QWERTY keyboard:
+//   1 2 3 4  ->  1 2 3 C
+//   Q W E R  ->  4 5 6 D
+//   A S D F  ->  7 8 9 E
+//   Z X C V  ->  A 0 B F
+constexpr std::string_view default_layout = "x123qweasdzc4rfv";
 
 } // namespace input
 
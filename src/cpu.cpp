@@ -1,212 +1,745 @@
 #include "cpu.hpp"
 
+#include "aot.hpp"
+#include "block_cache.hpp"
 #include "constants.hpp"
 #include "display.hpp"
 #include "io_manager.hpp"
-#include "memory.hpp"
-#include "utility.hpp"
+#include "jit_cache.hpp"
+#include "keypad.hpp"
+#include "machine_state.hpp"
+#include "op_stats.hpp"
+#include "quirks.hpp"
+#include "rewind.hpp"
+#include "save_state.hpp"
+#include "trace.hpp"
 
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <cassert>
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
 #include <print>
-#include <ranges>
 #include <span>
+#include <type_traits>
 
 namespace chip8
 {
 
-Cpu::Cpu(IOManager* io, Memory* mem, Display* display)
-    : io_{io}, mem_{mem}, display_{display}
+template <typename Quirks>
+constexpr std::array<Cpu::Handler, n_ops> Cpu::make_handlers() noexcept
 {
+    std::array<Handler, n_ops> handlers{};
+    const auto set = [&handlers](Op op, Handler handler) {
+        handlers[static_cast<std::size_t>(op)] = handler;
+    };
+
+    set(Op::UNDECODED, &Cpu::exec_unknown);
+    set(Op::EMPTY, &Cpu::exec_empty);
+    set(Op::UNKNOWN, &Cpu::exec_unknown);
+    set(Op::SYS_ADDR, &Cpu::exec_sys_addr);
+    set(Op::CLS, &Cpu::exec_cls);
+    set(Op::RET, &Cpu::exec_ret);
+    set(Op::JP_NNN, &Cpu::exec_jp_nnn);
+    set(Op::CALL, &Cpu::exec_call);
+    set(Op::SE_VX_NN, &Cpu::exec_se_vx_nn);
+    set(Op::SNE_VX_NN, &Cpu::exec_sne_vx_nn);
+    set(Op::SE_VX_VY, &Cpu::exec_se_vx_vy);
+    set(Op::LD_VX_NN, &Cpu::exec_ld_vx_nn);
+    set(Op::ADD_VX_NN, &Cpu::exec_add_vx_nn);
+    set(Op::LD_VX_VY, &Cpu::exec_ld_vx_vy);
+    set(Op::OR_VX_VY, &Cpu::exec_or_vx_vy<Quirks>);
+    set(Op::AND_VX_VY, &Cpu::exec_and_vx_vy<Quirks>);
+    set(Op::XOR_VX_VY, &Cpu::exec_xor_vx_vy<Quirks>);
+    set(Op::ADD_VX_VY, &Cpu::exec_add_vx_vy);
+    set(Op::SUB_VX_VY, &Cpu::exec_sub_vx_vy);
+    set(Op::SHR_VX_VY, &Cpu::exec_shr_vx_vy<Quirks>);
+    set(Op::SUBN_VX_VY, &Cpu::exec_subn_vx_vy);
+    set(Op::SHL_VX_VY, &Cpu::exec_shl_vx_vy<Quirks>);
+    set(Op::SNE_VX_VY, &Cpu::exec_sne_vx_vy);
+    set(Op::LD_I_NNN, &Cpu::exec_ld_i_nnn);
+    set(Op::JP_V0_NNN, &Cpu::exec_jp_v0_nnn<Quirks>);
+    set(Op::RND_VX_NN, &Cpu::exec_rnd_vx_nn);
+    set(Op::DRW_VX_VY_N, &Cpu::exec_drw_vx_vy_n<Quirks>);
+    set(Op::SKP_VX, &Cpu::exec_skp_vx);
+    set(Op::NSKP_VX, &Cpu::exec_nskp_vx);
+    set(Op::LD_VX_DT, &Cpu::exec_ld_vx_dt);
+    set(Op::LD_VX_K, &Cpu::exec_ld_vx_k);
+    set(Op::LD_DT_VX, &Cpu::exec_ld_dt_vx);
+    set(Op::LD_ST_VX, &Cpu::exec_ld_st_vx);
+    set(Op::ADD_I_VX, &Cpu::exec_add_i_vx);
+    set(Op::LD_F_VX, &Cpu::exec_ld_f_vx);
+    set(Op::LD_B_VX, &Cpu::exec_ld_b_vx);
+    set(Op::LD_I_VX, &Cpu::exec_ld_i_vx<Quirks>);
+    set(Op::LD_VX_I, &Cpu::exec_ld_vx_i<Quirks>);
+
+    return handlers;
+}
+
+template <typename Quirks>
+const std::array<Cpu::Handler, n_ops> Cpu::handlers_ =
+    Cpu::make_handlers<Quirks>();
+
+Cpu::Cpu(IOManager* io, CpuBackend backend, Profile profile)
+    : io_{io}, profile_{profile},
+      jit_{backend == CpuBackend::JIT ? make_jit_cache() : nullptr},
+      blocks_{backend == CpuBackend::BLOCKS ||
+                      (backend == CpuBackend::JIT && !jit_)
+                  ? std::make_unique<BlockCache>()
+                  : nullptr},
+      mem_{&state_}, display_{io, &state_}
+{
+    static_assert(std::ranges::none_of(make_handlers<quirks::Default>(),
+                                       std::logical_not{}),
+                  "every Op must have a handler");
+
     assert(io_);
-    assert(mem_);
-    assert(display_);
 }
 
+Cpu::~Cpu() = default;
+
 void Cpu::tick()
 {
-    io_->fetch_keys(keys_, false);
-    fetch();
-    execute();
+    visit(profile_, [this](auto quirks) {
+        fetch();
+        execute<decltype(quirks)>();
+    });
+}
+
+uint64_t Cpu::run(uint64_t max_cycles)
+{
+    return visit(profile_, [this, max_cycles](auto quirks) {
+        using Quirks = decltype(quirks);
+        return stats_ || tracer_ ? run_with<Quirks, true>(max_cycles)
+                                 : run_with<Quirks, false>(max_cycles);
+    });
+}
+
+void Cpu::set_profile(Profile profile) noexcept
+{
+    profile_ = profile;
+}
+
+void Cpu::seed_random(uint64_t seed) noexcept
+{
+    state_.random.seed(seed);
+}
+
+void Cpu::set_keys(KeyMask keys) noexcept
+{
+    state_.keys = keys;
+}
+
+void Cpu::attach(AotProgram const& program)
+{
+    aot_ = std::make_unique<AotRunner>(program);
+}
+
+// The pc may point past the end of memory between two instructions, the next
+// fetch wraps it: the state stores the address it is going to be fetched from.
+void Cpu::save_state(CpuState& state) const noexcept
+{
+    state.registers   = state_.registers;
+    state.index       = state_.index;
+    state.pc          = state_.pc & memory::address_mask;
+    state.stack       = state_.stack;
+    state.stack_ptr   = state_.stack_ptr;
+    state.delay_timer = state_.delay_timer;
+    state.sound_timer = state_.sound_timer;
+    state.random      = state_.random;
+}
+
+void Cpu::load_state(CpuState const& state) noexcept
+{
+    state_.registers   = state.registers;
+    state_.index       = state.index;
+    state_.pc          = state.pc;
+    state_.stack       = state.stack;
+    state_.stack_ptr   = state.stack_ptr;
+    state_.delay_timer = state.delay_timer;
+    state_.sound_timer = state.sound_timer;
+    state_.random      = state.random;
+}
+
+void Cpu::set_rewind_buffer(RewindBuffer* rewind) noexcept
+{
+    rewind_ = rewind;
+}
+
+void Cpu::set_op_stats(OpStats* stats) noexcept
+{
+    stats_ = stats;
+}
+
+void Cpu::set_tracer(Tracer* tracer) noexcept
+{
+    tracer_ = tracer;
 }
 
 void Cpu::update_timers()
 {
-    if (delay_timer_ > 0)
+    if (state_.delay_timer > 0)
     {
-        --delay_timer_;
+        --state_.delay_timer;
     }
 
-    if (sound_timer_ > 0)
+    // The tone plays for as many ticks as the value of the timer, the
+    // IOManager is only told when it starts and stops.
+    const bool sound_on = state_.sound_timer > 0;
+    if (sound_on != sound_on_)
+    {
+        io_->set_sound(sound_on);
+        sound_on_ = sound_on;
+    }
+    if (state_.sound_timer > 0)
     {
-        io_->play_beep();
-        --sound_timer_;
+        --state_.sound_timer;
+    }
+}
+
+void Cpu::invalidate(uint16_t address, uint16_t size) noexcept
+{
+    const std::size_t first = address / memory::instruction_size;
+    const std::size_t last  = std::min<std::size_t>(
+        (address + size - 1) / memory::instruction_size, decoded_.size() - 1);
+    for (auto i = first; i <= last; ++i)
+    {
+        decoded_[i].op = Op::UNDECODED;
+    }
+
+    if (jit_)
+    {
+        jit_->invalidate(address, size);
+    }
+
+    if (blocks_)
+    {
+        blocks_->invalidate(address, size);
+    }
+
+    if (aot_)
+    {
+        aot_->invalidate(address, size);
     }
 }
 
 void Cpu::log_opcode_error() const noexcept
 {
-    std::println(stderr, "Unknown or unsupported opcode: 0x{:04X}", opcode_);
+    std::println(stderr, "Unknown or unsupported opcode: 0x{:04X}",
+                 instr_.opcode);
+}
+
+uint16_t Cpu::read_opcode() const noexcept
+{
+    const auto& mem = state_.memory;
+    // NOLINTNEXTLINE(hicpp-signed-bitwise)
+    return (mem[state_.pc] << memory::byte) |
+           mem[(state_.pc + 1) & memory::address_mask];
+}
+
+void Cpu::write_memory(uint16_t address, std::span<const uint8_t> values)
+{
+    // At most two chunks: up to the end of memory and from its start.
+    while (!values.empty())
+    {
+        address &= memory::address_mask;
+        const auto size = static_cast<uint16_t>(
+            std::min<std::size_t>(values.size(), memory::size - address));
+        if (rewind_)
+        {
+            rewind_->record_memory(state_.memory, address, size);
+        }
+        std::ranges::copy(values.first(size), state_.memory.begin() + address);
+        invalidate(address, size);
+
+        values = values.subspan(size);
+        address += size;
+    }
 }
 
 void Cpu::fetch() noexcept
 {
-    const auto& mem = mem_->get_data();
+    // Jumps and skips can leave the pc past the end of memory.
+    state_.pc &= memory::address_mask;
+    if (state_.pc % memory::instruction_size == 0)
+    {
+        auto& slot = decoded_[state_.pc / memory::instruction_size];
+        if (slot.op == Op::UNDECODED)
+        {
+            slot = decode(read_opcode());
+        }
+        instr_ = slot;
+    }
+    else
+    {
+        instr_ = decode(read_opcode());
+    }
+    state_.pc += memory::instruction_size;
+}
+
+DecodedInstruction Cpu::peek(uint16_t address) const noexcept
+{
+    address &= memory::address_mask;
+    if (address % memory::instruction_size == 0)
+    {
+        const auto& slot = decoded_[address / memory::instruction_size];
+        if (slot.op != Op::UNDECODED)
+        {
+            return slot;
+        }
+    }
+    const auto& mem = state_.memory;
     // NOLINTNEXTLINE(hicpp-signed-bitwise)
-    opcode_ = (mem[pc_] << memory::byte) | mem[pc_ + 1];
-    pc_ += memory::instruction_size;
+    return decode(static_cast<uint16_t>(
+        (mem[address] << memory::byte) |
+        mem[(address + 1) & memory::address_mask]));
 }
 
-void Cpu::execute() noexcept
+uint64_t Cpu::idle_cycles(uint64_t remaining) const noexcept
+{
+    constexpr uint16_t poll_size = 3 * memory::instruction_size;
+    if (remaining == 0 || state_.pc + poll_size > memory::size)
+    {
+        return 0;
+    }
+
+    const auto first = peek(state_.pc);
+    if ((first.op == Op::JP_NNN && first.nnn == state_.pc) ||
+        (first.op == Op::LD_VX_K && state_.keys == 0))
+    {
+        return remaining;
+    }
+    if (first.op != Op::LD_VX_DT ||
+        state_.registers[first.x] != state_.delay_timer)
+    {
+        return 0;
+    }
+
+    // Vx already holds the delay timer, so every iteration takes the same
+    // path as the one that brought the pc back here.
+    const auto test = peek(state_.pc + memory::instruction_size);
+    const auto jump = peek(state_.pc + 2 * memory::instruction_size);
+    const bool loops =
+        (test.op == Op::SE_VX_NN && state_.delay_timer != test.nn) ||
+        (test.op == Op::SNE_VX_NN && state_.delay_timer == test.nn);
+    if (!loops || test.x != first.x || jump.op != Op::JP_NNN ||
+        jump.nnn != state_.pc)
+    {
+        return 0;
+    }
+    return remaining - remaining % 3;
+}
+
+template <typename Quirks, bool Instrumented>
+uint64_t Cpu::run_with(uint64_t max_cycles) noexcept
 {
-    if (opcode_ == instruction::empty)
+    if constexpr (std::is_same_v<Quirks, quirks::Default> && !Instrumented)
     {
-        std::println("Empty instruction skipped");
-        return;
+        if (aot_)
+        {
+            return run_aot(max_cycles);
+        }
     }
+    if constexpr (!Instrumented)
+    {
+        if (jit_)
+        {
+            return run_jit<Quirks>(max_cycles);
+        }
+    }
+    return blocks_ ? run_blocks<Quirks, Instrumented>(max_cycles)
+                   : run_interpreter<Quirks, Instrumented>(max_cycles);
+}
 
-    switch (opcode_ & mask::type)
+template <typename Quirks, bool Instrumented>
+uint64_t Cpu::run_interpreter(uint64_t max_cycles) noexcept
+{
+#if defined(CHIP8_THREADED_DISPATCH) && defined(__GNUC__)
+    if constexpr (!Instrumented)
     {
-    case instruction::type_0:
-        switch (opcode_)
+        return run_threaded<Quirks>(max_cycles);
+    }
+#endif
+    for (uint64_t i = 0; i < max_cycles; ++i)
+    {
+        fetch();
+        dispatch<Quirks, Instrumented>();
+        // Every idle loop goes back to its start with one of these.
+        if constexpr (!Instrumented)
         {
-        case instruction::_00e0:
-            exec_cls();
-            break;
-        case instruction::_00ee:
-            exec_ret();
-            break;
-        case instruction::_0nnn:
-            exec_sys_addr();
-            break;
-        default:
-            log_opcode_error();
-            break;
+            if (instr_.op == Op::JP_NNN || instr_.op == Op::LD_VX_K)
+            {
+                i += idle_cycles(max_cycles - i - 1);
+            }
         }
+    }
+    return max_cycles;
+}
+
+#if defined(CHIP8_THREADED_DISPATCH) && defined(__GNUC__)
+// Threaded code: every handler fetches and jumps to the next one on its own,
+// so that each indirect jump is predicted on the history of its handler
+// instead of sharing a single dispatch branch. Relies on the labels as values
+// extension of GCC and Clang.
+template <typename Quirks>
+uint64_t Cpu::run_threaded(uint64_t max_cycles) noexcept
+{
+    // NOLINTBEGIN(cppcoreguidelines-macro-usage,cppcoreguidelines-avoid-goto,
+    //             hicpp-avoid-goto)
+
+    // Must follow the order of the Op enumerators.
+    static void* const labels[] = {
+        &&unknown,    &&empty,      &&unknown,    &&sys_addr,   &&cls,
+        &&ret,        &&jp_nnn,     &&call,       &&se_vx_nn,   &&sne_vx_nn,
+        &&se_vx_vy,   &&ld_vx_nn,   &&add_vx_nn,  &&ld_vx_vy,   &&or_vx_vy,
+        &&and_vx_vy,  &&xor_vx_vy,  &&add_vx_vy,  &&sub_vx_vy,  &&shr_vx_vy,
+        &&subn_vx_vy, &&shl_vx_vy,  &&sne_vx_vy,  &&ld_i_nnn,   &&jp_v0_nnn,
+        &&rnd_vx_nn,  &&drw_vx_vy_n, &&skp_vx,    &&nskp_vx,    &&ld_vx_dt,
+        &&ld_vx_k,    &&ld_dt_vx,   &&ld_st_vx,   &&add_i_vx,   &&ld_f_vx,
+        &&ld_b_vx,    &&ld_i_vx,    &&ld_vx_i};
+    static_assert(std::size(labels) == n_ops);
+
+    uint64_t remaining = max_cycles;
+
+#define CHIP8_DISPATCH()                                                       \
+    if (remaining-- == 0)                                                      \
+    {                                                                          \
+        return max_cycles;                                                     \
+    }                                                                          \
+    fetch();                                                                   \
+    goto* labels[static_cast<std::size_t>(instr_.op)]
+
+#define CHIP8_HANDLER(name)                                                    \
+    name:                                                                      \
+    exec_##name();                                                             \
+    CHIP8_DISPATCH()
+
+    // Handler that depends on the quirks.
+#define CHIP8_QUIRK_HANDLER(name)                                              \
+    name:                                                                      \
+    exec_##name<Quirks>();                                                     \
+    CHIP8_DISPATCH()
+
+    // Handler of an instruction that can go back to the start of an idle
+    // loop.
+#define CHIP8_LOOP_HANDLER(name)                                               \
+    name:                                                                      \
+    exec_##name();                                                             \
+    remaining -= idle_cycles(remaining);                                       \
+    CHIP8_DISPATCH()
+
+    CHIP8_DISPATCH();
+
+    CHIP8_HANDLER(empty);
+    CHIP8_HANDLER(unknown);
+    CHIP8_HANDLER(sys_addr);
+    CHIP8_HANDLER(cls);
+    CHIP8_HANDLER(ret);
+    CHIP8_LOOP_HANDLER(jp_nnn);
+    CHIP8_HANDLER(call);
+    CHIP8_HANDLER(se_vx_nn);
+    CHIP8_HANDLER(sne_vx_nn);
+    CHIP8_HANDLER(se_vx_vy);
+    CHIP8_HANDLER(ld_vx_nn);
+    CHIP8_HANDLER(add_vx_nn);
+    CHIP8_HANDLER(ld_vx_vy);
+    CHIP8_QUIRK_HANDLER(or_vx_vy);
+    CHIP8_QUIRK_HANDLER(and_vx_vy);
+    CHIP8_QUIRK_HANDLER(xor_vx_vy);
+    CHIP8_HANDLER(add_vx_vy);
+    CHIP8_HANDLER(sub_vx_vy);
+    CHIP8_QUIRK_HANDLER(shr_vx_vy);
+    CHIP8_HANDLER(subn_vx_vy);
+    CHIP8_QUIRK_HANDLER(shl_vx_vy);
+    CHIP8_HANDLER(sne_vx_vy);
+    CHIP8_HANDLER(ld_i_nnn);
+    CHIP8_QUIRK_HANDLER(jp_v0_nnn);
+    CHIP8_HANDLER(rnd_vx_nn);
+    CHIP8_QUIRK_HANDLER(drw_vx_vy_n);
+    CHIP8_HANDLER(skp_vx);
+    CHIP8_HANDLER(nskp_vx);
+    CHIP8_HANDLER(ld_vx_dt);
+    CHIP8_LOOP_HANDLER(ld_vx_k);
+    CHIP8_HANDLER(ld_dt_vx);
+    CHIP8_HANDLER(ld_st_vx);
+    CHIP8_HANDLER(add_i_vx);
+    CHIP8_HANDLER(ld_f_vx);
+    CHIP8_HANDLER(ld_b_vx);
+    CHIP8_QUIRK_HANDLER(ld_i_vx);
+    CHIP8_QUIRK_HANDLER(ld_vx_i);
+
+#undef CHIP8_LOOP_HANDLER
+#undef CHIP8_QUIRK_HANDLER
+#undef CHIP8_HANDLER
+#undef CHIP8_DISPATCH
+
+    // NOLINTEND(cppcoreguidelines-macro-usage,cppcoreguidelines-avoid-goto,
+    //           hicpp-avoid-goto)
+}
+#endif
+
+template <typename Quirks, bool Instrumented>
+uint64_t Cpu::run_blocks(uint64_t max_cycles) noexcept
+{
+    uint64_t executed = 0;
+    while (executed < max_cycles)
+    {
+        const auto block = blocks_->lookup(state_.pc, state_.memory);
+        if (block.empty())
+        {
+            // The program counter points past the last complete instruction,
+            // or past the end of memory, let the interpreter wrap it.
+            executed += run_interpreter<Quirks, Instrumented>(1);
+            continue;
+        }
+
+        const auto n = std::min<uint64_t>(block.size(), max_cycles - executed);
+        for (const auto& instr : block.first(n))
+        {
+            instr_ = instr;
+            state_.pc += memory::instruction_size;
+            dispatch<Quirks, Instrumented>();
+        }
+        executed += n;
+
+        // Blocks end with every instruction that can close an idle loop.
+        if constexpr (!Instrumented)
+        {
+            executed += idle_cycles(max_cycles - executed);
+        }
+    }
+    return executed;
+}
+
+template <typename Quirks>
+uint64_t Cpu::run_jit(uint64_t max_cycles) noexcept
+{
+    uint64_t executed = 0;
+    while (executed < max_cycles)
+    {
+        const auto block = jit_->lookup(state_.pc, state_.memory, profile_,
+                                        &Cpu::execute_compiled<Quirks>);
+        if (!block.function)
+        {
+            // The program counter points past the last complete instruction,
+            // or past the end of memory, let the interpreter wrap it.
+            executed += run_interpreter<Quirks, false>(1);
+            continue;
+        }
+
+        // The block stops where the budget runs out.
+        const auto budget = max_cycles - executed;
+        executed += budget - block.function(&state_, this, budget);
+
+        // Like the interpreter, only looks for an idle loop after the
+        // instructions that close one.
+        if (block.closes_loop)
+        {
+            executed += idle_cycles(max_cycles - executed);
+        }
+    }
+    return executed;
+}
+
+template <typename Quirks>
+void Cpu::execute_compiled(Cpu* cpu, uint16_t opcode) noexcept
+{
+    cpu->instr_ = decode(opcode);
+    cpu->execute<Quirks>();
+}
+
+uint64_t Cpu::run_aot(uint64_t max_cycles) noexcept
+{
+    AotContext ctx(*this);
+
+    uint64_t executed = 0;
+    while (executed < max_cycles)
+    {
+        const auto* block = aot_->find(state_.pc);
+        if (!block || block->size > max_cycles - executed)
+        {
+            executed += run_interpreter<quirks::Default, false>(1);
+            continue;
+        }
+
+        block->function(ctx);
+        executed += block->size;
+        executed += idle_cycles(max_cycles - executed);
+    }
+    return executed;
+}
+
+template <typename Quirks, bool Instrumented>
+void Cpu::dispatch() noexcept
+{
+    if constexpr (Instrumented)
+    {
+        using clock = std::chrono::steady_clock;
+
+        // Both backends advance the pc before executing the instruction.
+        const auto pc =
+            static_cast<uint16_t>(state_.pc - memory::instruction_size);
+        const auto op = instr_.op;
+
+        if (stats_)
+        {
+            const auto start = clock::now();
+            execute<Quirks>();
+            stats_->record(op, clock::now() - start);
+        }
+        else
+        {
+            execute<Quirks>();
+        }
+
+        if (tracer_)
+        {
+            tracer_->record(pc, instr_.opcode, state_.index, state_.registers);
+        }
+    }
+    else
+    {
+        execute<Quirks>();
+    }
+}
+
+template <typename Quirks>
+void Cpu::execute() noexcept
+{
+#ifdef CHIP8_THREADED_DISPATCH
+    (this->*handlers_<Quirks>[static_cast<std::size_t>(instr_.op)])();
+#else
+    switch (instr_.op)
+    {
+    case Op::EMPTY:
+        exec_empty();
+        break;
+    case Op::SYS_ADDR:
+        exec_sys_addr();
+        break;
+    case Op::CLS:
+        exec_cls();
         break;
-    case instruction::_1nnn:
+    case Op::RET:
+        exec_ret();
+        break;
+    case Op::JP_NNN:
         exec_jp_nnn();
         break;
-    case instruction::_2nnn:
+    case Op::CALL:
         exec_call();
         break;
-    case instruction::_3xkk:
+    case Op::SE_VX_NN:
         exec_se_vx_nn();
         break;
-    case instruction::_4xkk:
+    case Op::SNE_VX_NN:
         exec_sne_vx_nn();
         break;
-    case instruction::_5xy0:
+    case Op::SE_VX_VY:
         exec_se_vx_vy();
         break;
-    case instruction::_6xkk:
+    case Op::LD_VX_NN:
         exec_ld_vx_nn();
         break;
-    case instruction::_7xkk:
+    case Op::ADD_VX_NN:
         exec_add_vx_nn();
         break;
-    case instruction::type_8:
-        switch (opcode_ & mask::type_8)
-        {
-        case instruction::_8xy0:
-            exec_ld_vx_vy();
-            break;
-        case instruction::_8xy1:
-            exec_or_vx_vy();
-            break;
-        case instruction::_8xy2:
-            exec_and_vx_vy();
-            break;
-        case instruction::_8xy3:
-            exec_xor_vx_vy();
-            break;
-        case instruction::_8xy4:
-            exec_add_vx_vy();
-            break;
-        case instruction::_8xy5:
-            exec_sub_vx_vy();
-            break;
-        case instruction::_8xy6:
-            exec_shr_vx_vy();
-            break;
-        case instruction::_8xy7:
-            exec_subn_vx_vy();
-            break;
-        case instruction::_8xye:
-            exec_shl_vx_vy();
-            break;
-        default:
-            log_opcode_error();
-            break;
-        }
+    case Op::LD_VX_VY:
+        exec_ld_vx_vy();
+        break;
+    case Op::OR_VX_VY:
+        exec_or_vx_vy<Quirks>();
+        break;
+    case Op::AND_VX_VY:
+        exec_and_vx_vy<Quirks>();
+        break;
+    case Op::XOR_VX_VY:
+        exec_xor_vx_vy<Quirks>();
+        break;
+    case Op::ADD_VX_VY:
+        exec_add_vx_vy();
+        break;
+    case Op::SUB_VX_VY:
+        exec_sub_vx_vy();
+        break;
+    case Op::SHR_VX_VY:
+        exec_shr_vx_vy<Quirks>();
+        break;
+    case Op::SUBN_VX_VY:
+        exec_subn_vx_vy();
+        break;
+    case Op::SHL_VX_VY:
+        exec_shl_vx_vy<Quirks>();
         break;
-    case instruction::_9xy0:
+    case Op::SNE_VX_VY:
         exec_sne_vx_vy();
         break;
-    case instruction::_annn:
+    case Op::LD_I_NNN:
         exec_ld_i_nnn();
         break;
-    case instruction::_bnnn:
-        exec_jp_v0_nnn();
+    case Op::JP_V0_NNN:
+        exec_jp_v0_nnn<Quirks>();
         break;
-    case instruction::_cxkk:
+    case Op::RND_VX_NN:
         exec_rnd_vx_nn();
         break;
-    case instruction::_dxyn:
-        exec_drw_vx_vy_n();
+    case Op::DRW_VX_VY_N:
+        exec_drw_vx_vy_n<Quirks>();
         break;
-    case instruction::type_e:
-        switch (opcode_ & mask::type_e)
-        {
-        case instruction::_ex9e:
-            exec_skp_vx();
-            break;
-        case instruction::_exa1:
-            exec_nskp_vx();
-            break;
-        default:
-            log_opcode_error();
-            break;
-        }
+    case Op::SKP_VX:
+        exec_skp_vx();
         break;
-    case instruction::type_f:
-        switch (opcode_ & mask::type_f)
-        {
-        case instruction::_fx07:
-            exec_ld_vx_dt();
-            break;
-        case instruction::_fx0a:
-            exec_ld_vx_k();
-            break;
-        case instruction::_fx15:
-            exec_ld_dt_vx();
-            break;
-        case instruction::_fx18:
-            exec_ld_st_vx();
-            break;
-        case instruction::_fx1e:
-            exec_add_i_vx();
-            break;
-        case instruction::_fx29:
-            exec_ld_f_vx();
-            break;
-        case instruction::_fx33:
-            exec_ld_b_vx();
-            break;
-        case instruction::_fx55:
-            exec_ld_i_vx();
-            break;
-        case instruction::_fx65:
-            exec_ld_vx_i();
-            break;
-        default:
-            log_opcode_error();
-            break;
-        }
+    case Op::NSKP_VX:
+        exec_nskp_vx();
+        break;
+    case Op::LD_VX_DT:
+        exec_ld_vx_dt();
+        break;
+    case Op::LD_VX_K:
+        exec_ld_vx_k();
+        break;
+    case Op::LD_DT_VX:
+        exec_ld_dt_vx();
         break;
-    default:
+    case Op::LD_ST_VX:
+        exec_ld_st_vx();
+        break;
+    case Op::ADD_I_VX:
+        exec_add_i_vx();
+        break;
+    case Op::LD_F_VX:
+        exec_ld_f_vx();
+        break;
+    case Op::LD_B_VX:
+        exec_ld_b_vx();
+        break;
+    case Op::LD_I_VX:
+        exec_ld_i_vx<Quirks>();
+        break;
+    case Op::LD_VX_I:
+        exec_ld_vx_i<Quirks>();
+        break;
+    case Op::UNDECODED:
+    case Op::UNKNOWN:
+        exec_unknown();
         break;
     }
+#endif
+}
+
+void Cpu::exec_empty() noexcept
+{
+    std::println(stderr, "Empty instruction skipped");
+}
+
+void Cpu::exec_unknown() noexcept
+{
+    log_opcode_error();
 }
 
 void Cpu::exec_sys_addr() noexcept
@@ -216,23 +749,23 @@ void Cpu::exec_sys_addr() noexcept
 
 void Cpu::exec_cls() noexcept
 {
-    display_->clear();
+    display_.clear();
 }
 
 void Cpu::exec_ret()
 {
-    pc_ = stack_[stack_ptr_--];
+    state_.pc = state_.stack[stack_slot(state_.stack_ptr--)];
 }
 
 void Cpu::exec_jp_nnn() noexcept
 {
-    pc_ = get_nnn();
+    state_.pc = get_nnn();
 }
 
 void Cpu::exec_call()
 {
-    stack_[++stack_ptr_] = pc_;
-    pc_                  = get_nnn();
+    state_.stack[stack_slot(++state_.stack_ptr)] = state_.pc;
+    state_.pc                                    = get_nnn();
 }
 
 void Cpu::exec_se_vx_nn() noexcept
@@ -241,7 +774,7 @@ void Cpu::exec_se_vx_nn() noexcept
     const auto nn = get_nn();
     if (vx == nn)
     {
-        pc_ += memory::instruction_size;
+        state_.pc += memory::instruction_size;
     }
 }
 
@@ -251,7 +784,7 @@ void Cpu::exec_sne_vx_nn() noexcept
     const auto nn = get_nn();
     if (vx != nn)
     {
-        pc_ += memory::instruction_size;
+        state_.pc += memory::instruction_size;
     }
 }
 
@@ -261,7 +794,7 @@ void Cpu::exec_se_vx_vy() noexcept
     const auto vy = get_vy();
     if (vx == vy)
     {
-        pc_ += memory::instruction_size;
+        state_.pc += memory::instruction_size;
     }
 }
 
@@ -283,22 +816,37 @@ void Cpu::exec_ld_vx_vy() noexcept
     vx       = get_vy();
 }
 
+template <typename Quirks>
 void Cpu::exec_or_vx_vy() noexcept
 {
     auto& vx = get_vx();
     vx |= get_vy();
+    if constexpr (Quirks::logic_resets_vf)
+    {
+        get_vf() = 0;
+    }
 }
 
+template <typename Quirks>
 void Cpu::exec_and_vx_vy() noexcept
 {
     auto& vx = get_vx();
     vx &= get_vy();
+    if constexpr (Quirks::logic_resets_vf)
+    {
+        get_vf() = 0;
+    }
 }
 
+template <typename Quirks>
 void Cpu::exec_xor_vx_vy() noexcept
 {
     auto& vx = get_vx();
     vx ^= get_vy();
+    if constexpr (Quirks::logic_resets_vf)
+    {
+        get_vf() = 0;
+    }
 }
 
 void Cpu::exec_add_vx_vy() noexcept
@@ -325,10 +873,15 @@ void Cpu::exec_sub_vx_vy() noexcept
     vf                = static_cast<uint16_t>(borrow);
 }
 
+template <typename Quirks>
 void Cpu::exec_shr_vx_vy() noexcept
 {
-    auto& vx          = get_vx();
-    auto& vf          = get_vf();
+    auto& vx = get_vx();
+    auto& vf = get_vf();
+    if constexpr (Quirks::shift_vy)
+    {
+        vx = get_vy();
+    }
     const uint8_t lsb = vx & mask::less_significant_bit;
     vx >>= 1u;
     vf = lsb;
@@ -346,10 +899,15 @@ void Cpu::exec_subn_vx_vy() noexcept
     vf                = static_cast<uint8_t>(borrow);
 }
 
+template <typename Quirks>
 void Cpu::exec_shl_vx_vy() noexcept
 {
     auto& vx = get_vx();
     auto& vf = get_vf();
+    if constexpr (Quirks::shift_vy)
+    {
+        vx = get_vy();
+    }
     // NOLINTNEXTLINE(hicpp-signed-bitwise)
     const uint8_t msb = (vx & mask::most_significant_bit) >> 7;
     vx <<= 1u;
@@ -362,45 +920,52 @@ void Cpu::exec_sne_vx_vy() noexcept
     const auto vy = get_vy();
     if (vx != vy)
     {
-        pc_ += memory::instruction_size;
+        state_.pc += memory::instruction_size;
     }
 }
 
 void Cpu::exec_ld_i_nnn() noexcept
 {
-    index_ = get_nnn();
+    state_.index = get_nnn();
 }
 
+template <typename Quirks>
 void Cpu::exec_jp_v0_nnn() noexcept
 {
-    const auto v0  = get_v0();
-    const auto nnn = get_nnn();
-    pc_            = v0 + nnn;
+    // x is the highest nibble of nnn.
+    const uint8_t base = Quirks::jump_vx ? get_vx() : get_v0();
+    const auto nnn     = get_nnn();
+    state_.pc          = base + nnn;
 }
 
 void Cpu::exec_rnd_vx_nn() noexcept
 {
     auto& vx          = get_vx();
     const auto nn     = get_nn();
-    const auto random = utility::random_byte();
+    const auto random = state_.random.next_byte();
     vx                = random & nn;
 }
 
+template <typename Quirks>
 void Cpu::exec_drw_vx_vy_n() noexcept
 {
-    const auto vx     = get_vx();
-    const auto vy     = get_vy();
-    const auto n      = get_n();
-    const auto sprite = std::span{mem_->get_data()}.subspan(index_, n);
-    auto& vf          = get_vf();
-    vf                = display_->draw(vx, vy, sprite) ? 1 : 0;
+    const auto vx      = get_vx();
+    const auto vy      = get_vy();
+    const auto n       = get_n();
+    const auto address = state_.index & memory::address_mask;
+    // Like VectorEngine, a sprite is cut at the end of memory.
+    const auto sprite = std::span{state_.memory}.subspan(
+        address, std::min<std::size_t>(n, memory::size - address));
+
+    auto& vf = get_vf();
+    vf       = display_.draw<Quirks::sprite_edge>(vx, vy, sprite) ? 1 : 0;
 }
 
 void Cpu::exec_skp_vx() noexcept
 {
     if (is_key_vx_pressed())
     {
-        pc_ += memory::instruction_size;
+        state_.pc += memory::instruction_size;
     }
 }
 
@@ -408,78 +973,90 @@ void Cpu::exec_nskp_vx() noexcept
 {
     if (!is_key_vx_pressed())
     {
-        pc_ += memory::instruction_size;
+        state_.pc += memory::instruction_size;
     }
 }
 
 void Cpu::exec_ld_vx_dt() noexcept
 {
     auto& vx = get_vx();
-    vx       = delay_timer_;
+    vx       = state_.delay_timer;
 }
 
 void Cpu::exec_ld_vx_k()
 {
-    auto* it = std::ranges::find_if(keys_, std::identity{});
-    if (it == keys_.end())
+    if (state_.keys == 0)
     {
-        pc_ -= memory::instruction_size;
+        state_.pc -= memory::instruction_size;
     }
     else
     {
+        // The lowest pressed key.
         auto& vx = get_vx();
-        vx       = std::distance(keys_.begin(), it);
+        vx       = static_cast<uint8_t>(std::countr_zero(state_.keys));
     }
 }
 
 void Cpu::exec_ld_dt_vx() noexcept
 {
-    delay_timer_ = get_vx();
+    state_.delay_timer = get_vx();
 }
 
 void Cpu::exec_ld_st_vx() noexcept
 {
-    sound_timer_ = get_vx();
+    state_.sound_timer = get_vx();
 }
 
 void Cpu::exec_add_i_vx() noexcept
 {
-    index_ += get_vx();
+    state_.index += get_vx();
 }
 
 void Cpu::exec_ld_f_vx() noexcept
 {
 
     const auto vx = get_vx();
-    index_        = memory::font_address + vx * font::letter_size;
+    state_.index  = memory::font_address + vx * font::letter_size;
 }
 
 void Cpu::exec_ld_b_vx()
 {
     const auto vx = get_vx();
-    auto& mem     = mem_->get_data();
     // NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers)
-    mem[index_]     = (vx / 100) % 10;
-    mem[index_ + 1] = (vx / 10) % 10;
-    mem[index_ + 2] = vx % 10;
+    const std::array<uint8_t, 3> digits{static_cast<uint8_t>((vx / 100) % 10),
+                                        static_cast<uint8_t>((vx / 10) % 10),
+                                        static_cast<uint8_t>(vx % 10)};
     // NOLINTEND(cppcoreguidelines-avoid-magic-numbers)
+    write_memory(state_.index, digits);
 }
 
+template <typename Quirks>
 void Cpu::exec_ld_i_vx()
 {
-    const auto x         = get_x();
-    const auto registers = registers_ | std::ranges::views::take(x + 1);
-    auto* mem            = mem_->get_data().begin() + index_;
-    std::ranges::copy(registers, mem);
+    const auto x = get_x();
+    write_memory(state_.index, std::span{state_.registers}.first(x + 1U));
+    if constexpr (Quirks::load_store_increments_i)
+    {
+        state_.index = (state_.index + x + 1) & memory::address_mask;
+    }
 }
 
+template <typename Quirks>
 void Cpu::exec_ld_vx_i()
 {
-    const auto x   = get_x();
-    const auto mem = mem_->get_data() | std::ranges::views::drop(index_) |
-                     std::ranges::views::take(x + 1);
-    auto* registers = registers_.begin();
-    std::ranges::copy(mem, registers);
+    const auto x = get_x();
+    for (uint8_t i = 0; i <= x; ++i)
+    {
+        state_.registers[i] =
+            state_.memory[(state_.index + i) & memory::address_mask];
+    }
+    if constexpr (Quirks::load_store_increments_i)
+    {
+        state_.index = (state_.index + x + 1) & memory::address_mask;
+    }
 }
 
+// Used by the code compiled ahead of time.
+template void Cpu::execute<quirks::Default>() noexcept;
+
 } // namespace chip8
@@ -2,32 +2,173 @@
 #define CHIP_8_CPU
 
 #include "constants.hpp"
+#include "decoder.hpp"
+#include "display.hpp"
+#include "keypad.hpp"
+#include "machine_state.hpp"
+#include "memory.hpp"
+#include "quirks.hpp"
 
 #include <array>
 #include <cstdint>
+#include <memory>
 
 namespace chip8
 {
 
 class IOManager;
-class Memory;
-class Display;
+class BlockCache;
+class JitCache;
+class AotRunner;
+struct AotProgram;
+struct CpuState;
+class RewindBuffer;
+struct OpStats;
+class Tracer;
+
+enum class CpuBackend : uint8_t
+{
+    // Fetches, decodes and executes one instruction at a time.
+    INTERPRETER,
+    // Decodes basic blocks once and executes them as a whole, through the
+    // handlers of the interpreter.
+    BLOCKS,
+    // Compiles basic blocks to x86-64 machine code, see JitCache. Runs as
+    // BLOCKS on the other hosts and where executable memory is refused.
+    JIT
+};
 
 class Cpu
 {
   public:
-    Cpu(IOManager* io, Memory* mem, Display* display);
+    explicit Cpu(IOManager* io, CpuBackend backend = CpuBackend::INTERPRETER,
+                 Profile profile = Profile::DEFAULT);
+    // The Memory and the Display point into the MachineState of the Cpu.
+    Cpu(Cpu const&) = delete;
+    Cpu(Cpu&&)      = delete;
+
+    ~Cpu();
+
+    Cpu& operator=(Cpu const&) = delete;
+    Cpu& operator=(Cpu&&)      = delete;
+
+    // The whole emulated machine. Memory and Display work on it too.
+    [[nodiscard]] MachineState& get_state() noexcept;
+    [[nodiscard]] MachineState const& get_state() const noexcept;
 
+    [[nodiscard]] Memory& get_memory() noexcept;
+    [[nodiscard]] Display& get_display() noexcept;
+    [[nodiscard]] Display const& get_display() const noexcept;
+
+    // Executes one instruction with the interpreter.
     void tick();
 
+    // Executes up to max_cycles instructions with the selected backend and
+    // profile and returns the number of instructions executed.
+    uint64_t run(uint64_t max_cycles);
+
+    // Changes how the instructions that differ between interpreters behave
+    // from the next instruction on.
+    void set_profile(Profile profile) noexcept;
+    [[nodiscard]] Profile get_profile() const noexcept;
+
+    // Restarts the random numbers drawn by Cxkk from the given seed. A Cpu
+    // is seeded with 0 until then.
+    void seed_random(uint64_t seed) noexcept;
+
+    // The keys read by the instructions, the IOManager is never asked for
+    // them.
+    void set_keys(KeyMask keys) noexcept;
+
+    // Makes run() execute the blocks of the program compiled ahead of time,
+    // the program must have been compiled from the loaded ROM. The compiled
+    // code implements the default profile, the others ignore it.
+    void attach(AotProgram const& program);
+
     void update_timers();
 
+    // Drops the cached decoding of the instructions overlapping the given
+    // memory range, must be called whenever memory is written.
+    void invalidate(uint16_t address, uint16_t size) noexcept;
+
+    // Copy the registers, the stack, the timers and the random generator to
+    // and from a state.
+    // Restoring does not touch memory, so the caller must invalidate what it
+    // changes there.
+    void save_state(CpuState& state) const noexcept;
+    void load_state(CpuState const& state) noexcept;
+
+    // Makes every memory write be recorded in the given buffer, nullptr stops
+    // recording.
+    void set_rewind_buffer(RewindBuffer* rewind) noexcept;
+
+    // Makes every executed instruction be counted and timed in the given
+    // stats, nullptr stops profiling. While profiling or tracing, the code
+    // compiled ahead of time or by the JIT is not used since it does not go
+    // through execute().
+    void set_op_stats(OpStats* stats) noexcept;
+
+    // Makes every executed instruction be appended to the given trace,
+    // nullptr stops tracing.
+    void set_tracer(Tracer* tracer) noexcept;
+
   private:
+    friend class AotContext;
+
+    using Handler = void (Cpu::*)();
+
+    // Handler of every Op for the given quirks, indexed by its value.
+    template <typename Quirks>
+    static constexpr std::array<Handler, n_ops> make_handlers() noexcept;
+    template <typename Quirks>
+    static const std::array<Handler, n_ops> handlers_;
+
     void log_opcode_error() const noexcept;
 
     void fetch() noexcept;
+    template <typename Quirks>
     void execute() noexcept;
 
+    // Instruction at the given address, decoded without touching the cache.
+    [[nodiscard]] DecodedInstruction peek(uint16_t address) const noexcept;
+
+    // Number of the remaining instructions that can be skipped because pc_ is
+    // at an idle loop: a jump to itself, Fx0A while no key is pressed, or Fx07
+    // followed by a 3xnn or 4xnn on Vx and a jump back, while the delay timer
+    // keeps it looping. The keys and the timers only change between frames,
+    // so such a loop runs until the end of the frame; only whole iterations
+    // are skipped, which leaves the state as if they had been executed.
+    [[nodiscard]] uint64_t idle_cycles(uint64_t remaining) const noexcept;
+
+    // The loops are instantiated for the quirks policy of every Profile,
+    // selected once per run(), and with and without instrumentation, i.e.
+    // profiling and tracing, so that the instructions executed without them
+    // pay nothing for it. Idle loops are only skipped without it, so that
+    // every instruction is still profiled and traced.
+    template <typename Quirks, bool Instrumented>
+    uint64_t run_with(uint64_t max_cycles) noexcept;
+    template <typename Quirks, bool Instrumented>
+    uint64_t run_interpreter(uint64_t max_cycles) noexcept;
+    template <typename Quirks>
+    uint64_t run_threaded(uint64_t max_cycles) noexcept;
+    template <typename Quirks, bool Instrumented>
+    uint64_t run_blocks(uint64_t max_cycles) noexcept;
+    template <typename Quirks>
+    uint64_t run_jit(uint64_t max_cycles) noexcept;
+    uint64_t run_aot(uint64_t max_cycles) noexcept;
+
+    // The JitHandler of the compiled code, executes the instruction with the
+    // handlers of the interpreter.
+    template <typename Quirks>
+    static void execute_compiled(Cpu* cpu, uint16_t opcode) noexcept;
+
+    // Calls execute() and, if Instrumented, records the instruction in stats_
+    // and tracer_ when they are set.
+    template <typename Quirks, bool Instrumented>
+    void dispatch() noexcept;
+
+    void exec_empty() noexcept;
+    void exec_unknown() noexcept;
     void exec_sys_addr() noexcept;
     void exec_cls() noexcept;
     void exec_ret();
@@ -39,18 +180,25 @@ class Cpu
     void exec_ld_vx_nn() noexcept;
     void exec_add_vx_nn() noexcept;
     void exec_ld_vx_vy() noexcept;
+    template <typename Quirks>
     void exec_or_vx_vy() noexcept;
+    template <typename Quirks>
     void exec_and_vx_vy() noexcept;
+    template <typename Quirks>
     void exec_xor_vx_vy() noexcept;
     void exec_add_vx_vy() noexcept;
     void exec_sub_vx_vy() noexcept;
+    template <typename Quirks>
     void exec_shr_vx_vy() noexcept;
     void exec_subn_vx_vy() noexcept;
+    template <typename Quirks>
     void exec_shl_vx_vy() noexcept;
     void exec_sne_vx_vy() noexcept;
     void exec_ld_i_nnn() noexcept;
+    template <typename Quirks>
     void exec_jp_v0_nnn() noexcept;
     void exec_rnd_vx_nn() noexcept;
+    template <typename Quirks>
     void exec_drw_vx_vy_n() noexcept;
     void exec_skp_vx() noexcept;
     void exec_nskp_vx() noexcept;
@@ -61,7 +209,9 @@ class Cpu
     void exec_add_i_vx() noexcept;
     void exec_ld_f_vx() noexcept;
     void exec_ld_b_vx();
+    template <typename Quirks>
     void exec_ld_i_vx();
+    template <typename Quirks>
     void exec_ld_vx_i();
 
     [[nodiscard]] uint8_t get_n() const noexcept;
@@ -80,85 +230,128 @@ class Cpu
 
     [[nodiscard]] bool is_key_vx_pressed() const noexcept;
 
+    [[nodiscard]] uint16_t read_opcode() const noexcept;
+
+    // Copies to memory, wrapping around its end, records what is overwritten
+    // for rewinding and invalidates the code there.
+    void write_memory(uint16_t address, std::span<const uint8_t> values);
+
     IOManager* io_;
+    Profile profile_;
+
+    // At most one of jit_ and blocks_ is set, the backend being the
+    // interpreter without either.
+    std::unique_ptr<JitCache> jit_;
+    std::unique_ptr<BlockCache> blocks_;
+    std::unique_ptr<AotRunner> aot_;
 
-    Memory* mem_;
-    Display* display_;
+    RewindBuffer* rewind_{nullptr};
+    OpStats* stats_{nullptr};
+    Tracer* tracer_{nullptr};
 
-    std::array<uint8_t, cpu::n_registers> registers_{};
-    uint16_t index_{};
-    uint16_t pc_{memory::free_address};
-    std::array<uint16_t, cpu::stack_size> stack_{};
-    int8_t stack_ptr_{-1};
+    // Whether the IOManager is playing the tone.
+    bool sound_on_{false};
 
-    uint8_t delay_timer_{};
-    uint8_t sound_timer_{};
+    DecodedInstruction instr_{};
 
-    std::array<bool, input::n_keys> keys_{};
+    // Decoded instructions indexed by address / instruction_size. Instructions
+    // at odd addresses are rare enough that they are decoded every time.
+    std::array<DecodedInstruction, memory::size / memory::instruction_size>
+        decoded_{};
 
-    uint16_t opcode_{};
+    // The machine, which the Memory and the Display work on.
+    MachineState state_;
+    Memory mem_;
+    Display display_;
 };
 
 inline uint8_t Cpu::get_n() const noexcept
 {
-    return opcode_ & mask::n;
+    return instr_.n;
 }
 
 inline uint8_t Cpu::get_nn() const noexcept
 {
-    return opcode_ & mask::nn;
+    return instr_.nn;
 }
 
 inline uint16_t Cpu::get_nnn() const noexcept
 {
-    return opcode_ & mask::nnn;
+    return instr_.nnn;
 }
 
 inline uint8_t Cpu::get_x() const noexcept
 {
-    // NOLINTNEXTLINE(hicpp-signed-bitwise)
-    return (opcode_ & mask::x) >> offset::x;
+    return instr_.x;
 }
 
 inline uint8_t Cpu::get_y() const noexcept
 {
-    // NOLINTNEXTLINE(hicpp-signed-bitwise)
-    return (opcode_ & mask::y) >> offset::y;
+    return instr_.y;
 }
 
 inline uint8_t Cpu::get_vx() const noexcept
 {
     const uint8_t x = get_x();
-    return registers_[x];
+    return state_.registers[x];
 }
 
 inline uint8_t& Cpu::get_vx() noexcept
 {
     const uint8_t x = get_x();
-    return registers_[x];
+    return state_.registers[x];
 }
 
 inline uint8_t& Cpu::get_vy() noexcept
 {
     const uint8_t y = get_y();
-    return registers_[y];
+    return state_.registers[y];
 }
 
 inline uint8_t& Cpu::get_v0() noexcept
 {
-    return registers_[0x0];
+    return state_.registers[0x0];
 }
 
 inline uint8_t& Cpu::get_vf() noexcept
 {
     // NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
-    return registers_[0xf];
+    return state_.registers[0xf];
 }
 
 inline bool Cpu::is_key_vx_pressed() const noexcept
 {
-    const auto vx = get_vx();
-    return keys_[vx];
+    return is_pressed(state_.keys, get_vx());
+}
+
+inline Profile Cpu::get_profile() const noexcept
+{
+    return profile_;
+}
+
+inline MachineState& Cpu::get_state() noexcept
+{
+    return state_;
+}
+
+inline MachineState const& Cpu::get_state() const noexcept
+{
+    return state_;
+}
+
+inline Memory& Cpu::get_memory() noexcept
+{
+    return mem_;
+}
+
+inline Display& Cpu::get_display() noexcept
+{
+    return display_;
+}
+
+inline Display const& Cpu::get_display() const noexcept
+{
+    return display_;
 }
 
 } // namespace chip8
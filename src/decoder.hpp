@@ -0,0 +1,197 @@
+#ifndef CHIP_8_DECODER
+#define CHIP_8_DECODER
+
+#include "constants.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace chip8
+{
+
+enum class Op : uint8_t
+{
+    // Marks a slot of the decoded instruction cache that must be (re)decoded.
+    UNDECODED = 0,
+    EMPTY,
+    UNKNOWN,
+    SYS_ADDR,
+    CLS,
+    RET,
+    JP_NNN,
+    CALL,
+    SE_VX_NN,
+    SNE_VX_NN,
+    SE_VX_VY,
+    LD_VX_NN,
+    ADD_VX_NN,
+    LD_VX_VY,
+    OR_VX_VY,
+    AND_VX_VY,
+    XOR_VX_VY,
+    ADD_VX_VY,
+    SUB_VX_VY,
+    SHR_VX_VY,
+    SUBN_VX_VY,
+    SHL_VX_VY,
+    SNE_VX_VY,
+    LD_I_NNN,
+    JP_V0_NNN,
+    RND_VX_NN,
+    DRW_VX_VY_N,
+    SKP_VX,
+    NSKP_VX,
+    LD_VX_DT,
+    LD_VX_K,
+    LD_DT_VX,
+    LD_ST_VX,
+    ADD_I_VX,
+    LD_F_VX,
+    LD_B_VX,
+    LD_I_VX,
+    LD_VX_I
+};
+
+constexpr std::size_t n_ops = static_cast<std::size_t>(Op::LD_VX_I) + 1;
+
+// Instruction with the handler and all the operands already extracted from the
+// opcode, so that executing it again does not require any further decoding.
+struct DecodedInstruction
+{
+    Op op{Op::UNDECODED};
+    uint8_t x{};
+    uint8_t y{};
+    uint8_t n{};
+    uint8_t nn{};
+    uint16_t nnn{};
+    uint16_t opcode{};
+};
+
+namespace detail
+{
+
+constexpr Op decode_op(uint16_t opcode) noexcept
+{
+    if (opcode == instruction::empty)
+    {
+        return Op::EMPTY;
+    }
+
+    switch (opcode & mask::type)
+    {
+    case instruction::type_0:
+        switch (opcode)
+        {
+        case instruction::_00e0:
+            return Op::CLS;
+        case instruction::_00ee:
+            return Op::RET;
+        default:
+            return Op::SYS_ADDR;
+        }
+    case instruction::_1nnn:
+        return Op::JP_NNN;
+    case instruction::_2nnn:
+        return Op::CALL;
+    case instruction::_3xkk:
+        return Op::SE_VX_NN;
+    case instruction::_4xkk:
+        return Op::SNE_VX_NN;
+    case instruction::_5xy0:
+        return Op::SE_VX_VY;
+    case instruction::_6xkk:
+        return Op::LD_VX_NN;
+    case instruction::_7xkk:
+        return Op::ADD_VX_NN;
+    case instruction::type_8:
+        switch (opcode & mask::type_8)
+        {
+        case instruction::_8xy0:
+            return Op::LD_VX_VY;
+        case instruction::_8xy1:
+            return Op::OR_VX_VY;
+        case instruction::_8xy2:
+            return Op::AND_VX_VY;
+        case instruction::_8xy3:
+            return Op::XOR_VX_VY;
+        case instruction::_8xy4:
+            return Op::ADD_VX_VY;
+        case instruction::_8xy5:
+            return Op::SUB_VX_VY;
+        case instruction::_8xy6:
+            return Op::SHR_VX_VY;
+        case instruction::_8xy7:
+            return Op::SUBN_VX_VY;
+        case instruction::_8xye:
+            return Op::SHL_VX_VY;
+        default:
+            return Op::UNKNOWN;
+        }
+    case instruction::_9xy0:
+        return Op::SNE_VX_VY;
+    case instruction::_annn:
+        return Op::LD_I_NNN;
+    case instruction::_bnnn:
+        return Op::JP_V0_NNN;
+    case instruction::_cxkk:
+        return Op::RND_VX_NN;
+    case instruction::_dxyn:
+        return Op::DRW_VX_VY_N;
+    case instruction::type_e:
+        switch (opcode & mask::type_e)
+        {
+        case instruction::_ex9e:
+            return Op::SKP_VX;
+        case instruction::_exa1:
+            return Op::NSKP_VX;
+        default:
+            return Op::UNKNOWN;
+        }
+    case instruction::type_f:
+        switch (opcode & mask::type_f)
+        {
+        case instruction::_fx07:
+            return Op::LD_VX_DT;
+        case instruction::_fx0a:
+            return Op::LD_VX_K;
+        case instruction::_fx15:
+            return Op::LD_DT_VX;
+        case instruction::_fx18:
+            return Op::LD_ST_VX;
+        case instruction::_fx1e:
+            return Op::ADD_I_VX;
+        case instruction::_fx29:
+            return Op::LD_F_VX;
+        case instruction::_fx33:
+            return Op::LD_B_VX;
+        case instruction::_fx55:
+            return Op::LD_I_VX;
+        case instruction::_fx65:
+            return Op::LD_VX_I;
+        default:
+            return Op::UNKNOWN;
+        }
+    default:
+        return Op::UNKNOWN;
+    }
+}
+
+} // namespace detail
+
+[[nodiscard]] constexpr DecodedInstruction decode(uint16_t opcode) noexcept
+{
+    // NOLINTBEGIN(hicpp-signed-bitwise)
+    return DecodedInstruction{
+        .op     = detail::decode_op(opcode),
+        .x      = static_cast<uint8_t>((opcode & mask::x) >> offset::x),
+        .y      = static_cast<uint8_t>((opcode & mask::y) >> offset::y),
+        .n      = static_cast<uint8_t>(opcode & mask::n),
+        .nn     = static_cast<uint8_t>(opcode & mask::nn),
+        .nnn    = static_cast<uint16_t>(opcode & mask::nnn),
+        .opcode = opcode};
+    // NOLINTEND(hicpp-signed-bitwise)
+}
+
+} // namespace chip8
+
+#endif // CHIP_8_DECODER
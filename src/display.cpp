@@ -1,62 +1,80 @@
 #include "display.hpp"
 
 #include "constants.hpp"
+#include "framebuffer.hpp"
 #include "io_manager.hpp"
-#include "utility.hpp"
+#include "machine_state.hpp"
+#include "rewind.hpp"
 
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <span>
 
 namespace chip8
 {
 
-Display::Display(IOManager* io) : io_{io}
+Display::Display(IOManager* io, MachineState* state) : io_{io}, state_{state}
 {
     assert(io_);
+    assert(state_);
 }
 
 void Display::clear() noexcept
 {
-    for (auto& row : display_)
+    if (rewind_)
     {
-        std::ranges::fill(row, false);
+        rewind_->record_rows(state_->framebuffer, 0, display::height_size);
     }
+    std::ranges::fill(state_->framebuffer.rows, 0);
 }
 
+template <SpriteEdge Edge>
 bool Display::draw(uint8_t coord_x, uint8_t coord_y,
                    std::span<const uint8_t> sprite) noexcept
 {
-    bool is_any_pixel_turned_off = false;
-    int n_sprite_rows            = 0;
-    for (const auto sprite_row : sprite)
+    if constexpr (Edge != SpriteEdge::CLIP)
     {
-        for (uint8_t i = 0; i < sprite::width; ++i)
-        {
-            const uint8_t y = coord_y + n_sprite_rows;
-            const uint8_t x = coord_x + i;
-
-            if (display::height_size <= y)
-            {
-                return is_any_pixel_turned_off;
-            }
-            if (display::width_size <= x)
-            {
-                continue;
-            }
+        coord_x %= display::width_size;
+        coord_y %= display::height_size;
+    }
 
-            auto& pixel           = display_[y][x];
-            const auto prev_pixel = pixel;
-            // NOLINTNEXTLINE(hicpp-signed-bitwise)
-            pixel ^= (sprite_row >> (sprite::width - i - 1)) & 1;
-            is_any_pixel_turned_off |= prev_pixel && !pixel;
+    if (rewind_)
+    {
+        const auto n_rows = visible_rows(coord_y, sprite.size());
+        rewind_->record_rows(state_->framebuffer, coord_y, n_rows);
+        if constexpr (Edge == SpriteEdge::WRAP)
+        {
+            // The rows that wrapped around to the top.
+            rewind_->record_rows(state_->framebuffer, 0,
+                                 sprite.size() - n_rows);
         }
-
-        ++n_sprite_rows;
     }
     updated_ = true;
 
-    return is_any_pixel_turned_off;
+    if constexpr (Edge == SpriteEdge::WRAP)
+    {
+        return wrap_sprite(state_->framebuffer, coord_x, coord_y, sprite);
+    }
+    else
+    {
+        return draw_sprite(state_->framebuffer, coord_x, coord_y, sprite);
+    }
+}
+
+template bool
+Display::draw<SpriteEdge::CLIP>(uint8_t, uint8_t,
+                                std::span<const uint8_t>) noexcept;
+template bool
+Display::draw<SpriteEdge::WRAP_ORIGIN>(uint8_t, uint8_t,
+                                       std::span<const uint8_t>) noexcept;
+template bool
+Display::draw<SpriteEdge::WRAP>(uint8_t, uint8_t,
+                                std::span<const uint8_t>) noexcept;
+
+void Display::set_rewind_buffer(RewindBuffer* rewind) noexcept
+{
+    rewind_ = rewind;
 }
 
 void Display::print()
@@ -66,9 +84,15 @@ void Display::print()
         return;
     }
 
-    io_->render(display_);
+    io_->render(state_->framebuffer);
 
     updated_ = false;
 }
 
+void Display::load_framebuffer(Framebuffer const& framebuffer) noexcept
+{
+    state_->framebuffer = framebuffer;
+    updated_            = true;
+}
+
 } // namespace chip8
@@ -2,35 +2,56 @@
 #define CHIP_8_DISPLAY
 
 #include "constants.hpp"
-#include "utility.hpp"
+#include "framebuffer.hpp"
+#include "machine_state.hpp"
 
+#include <cstdint>
 #include <span>
 
 namespace chip8
 {
 
 class IOManager;
+class RewindBuffer;
 
+// The screen of a MachineState, presented through the IOManager.
 class Display
 {
   public:
-    explicit Display(IOManager* io);
+    Display(IOManager* io, MachineState* state);
 
     void clear() noexcept;
 
+    // Instantiated for every SpriteEdge, see draw_sprite() and wrap_sprite().
+    template <SpriteEdge Edge>
     bool draw(uint8_t coord_x, uint8_t coord_y,
               std::span<const uint8_t> sprite) noexcept;
 
     void print();
 
+    // Replaces the content of the screen, e.g. when restoring a save state.
+    void load_framebuffer(Framebuffer const& framebuffer) noexcept;
+
+    // Makes every change to the framebuffer be recorded in the given buffer,
+    // nullptr stops recording.
+    void set_rewind_buffer(RewindBuffer* rewind) noexcept;
+
+    [[nodiscard]] const Framebuffer& get_framebuffer() const noexcept;
+
   private:
     IOManager* io_;
+    MachineState* state_;
 
-    utility::matrix<bool, display::height_size, display::width_size> display_{};
+    RewindBuffer* rewind_{nullptr};
 
     bool updated_{false};
 };
 
+inline const Framebuffer& Display::get_framebuffer() const noexcept
+{
+    return state_->framebuffer;
+}
+
 } // namespace chip8
 
 #endif // CHIP_8_DISPLAY
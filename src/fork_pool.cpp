@@ -0,0 +1,68 @@
+#include "fork_pool.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace chip8
+{
+
+std::string_view to_string(ForkError error) noexcept
+{
+    switch (error)
+    {
+        using enum ForkError;
+    case DISABLED:
+        return "forks are not enabled";
+    case NO_ROM:
+        return "no ROM loaded";
+    case POOL_EXHAUSTED:
+        return "no free fork slot";
+    }
+    return "unknown error";
+}
+
+ForkPool::ForkPool(Config config)
+    : slots_(std::max<uint32_t>(1, config.capacity)),
+      in_use_(slots_.size())
+{
+    free_.reserve(slots_.size());
+    // The first slots are handed out first.
+    for (auto i = static_cast<uint32_t>(slots_.size()); i-- > 0;)
+    {
+        free_.push_back(i);
+    }
+}
+
+Fork* ForkPool::acquire() noexcept
+{
+    if (free_.empty())
+    {
+        return nullptr;
+    }
+
+    const auto index = free_.back();
+    free_.pop_back();
+    in_use_[index] = true;
+    return &slots_[index];
+}
+
+void ForkPool::release(Fork const* fork) noexcept
+{
+    assert(fork >= slots_.data() && fork < slots_.data() + slots_.size());
+
+    const auto index = static_cast<uint32_t>(fork - slots_.data());
+    assert(in_use_[index]);
+    // A second push would also outgrow the capacity reserved for free_, and
+    // could throw.
+    if (!in_use_[index])
+    {
+        return;
+    }
+    in_use_[index] = false;
+    free_.push_back(index);
+}
+
+} // namespace chip8
@@ -0,0 +1,94 @@
+#ifndef CHIP_8_FORK_POOL
+#define CHIP_8_FORK_POOL
+
+#include "constants.hpp"
+#include "machine_state.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace chip8
+{
+
+enum class ForkError : uint8_t
+{
+    // Chip8::enable_forks() was not called.
+    DISABLED,
+    // There is no ROM or state to fork.
+    NO_ROM,
+    // Every slot of the pool is in use.
+    POOL_EXHAUSTED
+};
+
+std::string_view to_string(ForkError error) noexcept;
+
+struct ForkPoolConfig
+{
+    // Forks that can be alive at the same time.
+    uint32_t capacity{fork::default_capacity};
+};
+
+// The emulated state of a Chip8 at the time it was forked: the machine and
+// the frame it was at, which the number of instructions of the next frames
+// depends on. Nothing of the host side is kept, i.e. the IOManager, the
+// decoded code and the debugging tools.
+struct Fork
+{
+    MachineState machine;
+    uint64_t frames{};
+    uint64_t instructions{};
+};
+
+static_assert(std::is_trivially_copyable_v<Fork>);
+
+// Fixed set of Fork slots, so that branching a machine during a search costs
+// a copy and no allocation. All the slots are allocated at construction
+// time. The free slots are reused last released first, as they are the most
+// likely to still be in cache.
+//
+// The pool is not thread-safe.
+class ForkPool
+{
+  public:
+    using Config = ForkPoolConfig;
+
+    explicit ForkPool(Config config);
+
+    [[nodiscard]] std::size_t capacity() const noexcept;
+
+    // Number of slots in use.
+    [[nodiscard]] std::size_t size() const noexcept;
+
+    // A free slot, with unspecified content, or nullptr if every slot is in
+    // use.
+    [[nodiscard]] Fork* acquire() noexcept;
+
+    // Returns a slot obtained from acquire() to the pool. Releasing a slot
+    // that is already free is a bug, caught by an assertion, and otherwise
+    // does nothing.
+    void release(Fork const* fork) noexcept;
+
+  private:
+    std::vector<Fork> slots_;
+    // Indices of the free slots, the next one to use last.
+    std::vector<uint32_t> free_;
+    // Whether each slot has been acquired and not released yet.
+    std::vector<bool> in_use_;
+};
+
+inline std::size_t ForkPool::capacity() const noexcept
+{
+    return slots_.size();
+}
+
+inline std::size_t ForkPool::size() const noexcept
+{
+    return slots_.size() - free_.size();
+}
+
+} // namespace chip8
+
+#endif // CHIP_8_FORK_POOL
@@ -0,0 +1,112 @@
+#include "framebuffer.hpp"
+
+#include "constants.hpp"
+#include "utility.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+
+namespace chip8
+{
+
+std::size_t visible_rows(uint8_t y, std::size_t height) noexcept
+{
+    return std::min<std::size_t>(height,
+                                 std::max(0, display::height_size - y));
+}
+
+bool draw_sprite(Framebuffer& framebuffer, uint8_t x, uint8_t y,
+                 std::span<const uint8_t> sprite) noexcept
+{
+    // Column of the leftmost sprite pixel. The pixel columns are computed on 8
+    // bits, so a sprite starting near 255 wraps around to the left edge.
+    constexpr int columns = std::numeric_limits<uint8_t>::max() + 1;
+    const int column      = x < display::width_size ? x : x - columns;
+
+    // Shifting left by more than this pushes every sprite pixel out of the
+    // row, i.e. the sprite starts too far to the left to be visible.
+    constexpr int max_shift = display::width_size - 1;
+    const int shift         = display::width_size - sprite::width - column;
+    if (shift > max_shift)
+    {
+        return false;
+    }
+
+    bool is_any_pixel_turned_off = false;
+    const auto n_rows            = visible_rows(y, sprite.size());
+    for (std::size_t i = 0; i < n_rows; ++i)
+    {
+        const Framebuffer::Row sprite_row = sprite[i];
+        // NOLINTBEGIN(hicpp-signed-bitwise)
+        const auto bits =
+            shift >= 0 ? sprite_row << shift : sprite_row >> -shift;
+        // NOLINTEND(hicpp-signed-bitwise)
+
+        auto& row = framebuffer.rows[y + i];
+        is_any_pixel_turned_off |= (row & bits) != 0;
+        row ^= bits;
+    }
+    return is_any_pixel_turned_off;
+}
+
+bool wrap_sprite(Framebuffer& framebuffer, uint8_t x, uint8_t y,
+                 std::span<const uint8_t> sprite) noexcept
+{
+    x %= display::width_size;
+    y %= display::height_size;
+
+    bool is_any_pixel_turned_off = false;
+    for (std::size_t i = 0; i < sprite.size(); ++i)
+    {
+        // The sprite row starts as the leftmost byte of the row and is
+        // rotated right into place, so the pixels past the right edge come
+        // back on the left.
+        const Framebuffer::Row sprite_row = sprite[i];
+        const auto bits = std::rotr(
+            sprite_row << (display::width_size - sprite::width), x);
+
+        auto& row = framebuffer.rows[(y + i) % display::height_size];
+        is_any_pixel_turned_off |= (row & bits) != 0;
+        row ^= bits;
+    }
+    return is_any_pixel_turned_off;
+}
+
+utility::matrix<bool, display::height_size, display::width_size> to_matrix(
+    Framebuffer const& framebuffer) noexcept
+{
+    utility::matrix<bool, display::height_size, display::width_size> pixels{};
+    for (uint8_t y = 0; y < display::height_size; ++y)
+    {
+        for (uint8_t x = 0; x < display::width_size; ++x)
+        {
+            pixels[y][x] = framebuffer.is_on(x, y);
+        }
+    }
+    return pixels;
+}
+
+uint64_t hash(Framebuffer const& framebuffer) noexcept
+{
+    constexpr uint64_t offset_basis = 0xcbf29ce484222325;
+    constexpr uint64_t prime        = 0x100000001b3;
+
+    // The rows are hashed byte by byte from the most significant one, so that
+    // the result does not depend on the host endianness.
+    uint64_t h = offset_basis;
+    for (const auto row : framebuffer.rows)
+    {
+        for (int shift = 56; shift >= 0; shift -= 8)
+        {
+            h ^= (row >> shift) & 0xff;
+            h *= prime;
+        }
+    }
+    return h;
+}
+
+} // namespace chip8
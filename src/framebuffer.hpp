@@ -0,0 +1,77 @@
+#ifndef CHIP_8_FRAMEBUFFER
+#define CHIP_8_FRAMEBUFFER
+
+#include "constants.hpp"
+#include "utility.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+
+namespace chip8
+{
+
+// Monochrome framebuffer packed as one word per row, the most significant bit
+// of a row is its leftmost pixel.
+struct Framebuffer
+{
+    using Row = uint64_t;
+
+    static_assert(std::numeric_limits<Row>::digits == display::width_size,
+                  "a row must hold exactly one bit per pixel");
+
+    std::array<Row, display::height_size> rows{};
+
+    [[nodiscard]] bool is_on(uint8_t x, uint8_t y) const noexcept;
+
+    bool operator==(Framebuffer const&) const = default;
+};
+
+inline bool Framebuffer::is_on(uint8_t x, uint8_t y) const noexcept
+{
+    // NOLINTNEXTLINE(hicpp-signed-bitwise)
+    return (rows[y] >> (display::width_size - 1 - x)) & 1u;
+}
+
+// What happens to a sprite drawn across the edges of the screen.
+enum class SpriteEdge : uint8_t
+{
+    // The coordinates are used as they are and the pixels off the screen are
+    // dropped, see draw_sprite().
+    CLIP,
+    // The coordinates wrap around the screen first, then the pixels off the
+    // screen are dropped.
+    WRAP_ORIGIN,
+    // The pixels off an edge of the screen appear on the opposite edge, see
+    // wrap_sprite().
+    WRAP
+};
+
+// Number of rows of a sprite of the given height drawn at row y that are on
+// the screen, the ones below the bottom edge are clipped.
+[[nodiscard]] std::size_t visible_rows(uint8_t y, std::size_t height) noexcept;
+
+// XORs the sprite onto the framebuffer with its top left corner at (x, y),
+// clipping the pixels that fall off the screen. Returns whether any pixel was
+// turned off.
+bool draw_sprite(Framebuffer& framebuffer, uint8_t x, uint8_t y,
+                 std::span<const uint8_t> sprite) noexcept;
+
+// XORs the sprite onto the framebuffer with its top left corner at (x, y),
+// taken modulo the size of the screen, wrapping the pixels that fall off an
+// edge around to the opposite one. Returns whether any pixel was turned off.
+bool wrap_sprite(Framebuffer& framebuffer, uint8_t x, uint8_t y,
+                 std::span<const uint8_t> sprite) noexcept;
+
+// Adapter for the consumers that work with one boolean per pixel.
+[[nodiscard]] utility::matrix<bool, display::height_size, display::width_size>
+to_matrix(Framebuffer const& framebuffer) noexcept;
+
+// 64-bit FNV-1a hash of the framebuffer content, stable across hosts.
+[[nodiscard]] uint64_t hash(Framebuffer const& framebuffer) noexcept;
+
+} // namespace chip8
+
+#endif // CHIP_8_FRAMEBUFFER
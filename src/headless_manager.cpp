@@ -0,0 +1,43 @@
+#include "headless_manager.hpp"
+
+#include "constants.hpp"
+#include "framebuffer.hpp"
+#include "keypad.hpp"
+
+namespace chip8
+{
+
+HeadlessManager::HeadlessManager() noexcept = default;
+
+HeadlessManager::~HeadlessManager() = default;
+
+bool HeadlessManager::start() noexcept
+{
+    running_ = true;
+    return running_;
+}
+
+bool HeadlessManager::update() noexcept
+{
+    return running_;
+}
+
+void HeadlessManager::stop() noexcept
+{
+    running_ = false;
+}
+
+KeyMask HeadlessManager::get_keys() const noexcept
+{
+    return 0;
+}
+
+void HeadlessManager::render(Framebuffer const& /*framebuffer*/) noexcept
+{
+}
+
+void HeadlessManager::set_sound(bool /*on*/) noexcept
+{
+}
+
+} // namespace chip8
@@ -0,0 +1,49 @@
+#ifndef CHIP_8_HEADLESS_MANAGER
+#define CHIP_8_HEADLESS_MANAGER
+
+#include "constants.hpp"
+#include "framebuffer.hpp"
+#include "io_manager.hpp"
+
+namespace chip8
+{
+
+// IOManager without any window, audio or input device: rendered frames and
+// beeps are discarded and no key is ever pressed. Used to run ROMs on hosts
+// without a display.
+class HeadlessManager : public IOManager
+{
+  public:
+    HeadlessManager() noexcept;
+    HeadlessManager(const HeadlessManager&) = delete;
+    HeadlessManager(HeadlessManager&&)      = delete;
+
+    ~HeadlessManager() override;
+
+    HeadlessManager& operator=(const HeadlessManager&) = delete;
+    HeadlessManager& operator=(HeadlessManager&&)      = delete;
+
+    [[nodiscard]] bool is_running() const noexcept override;
+
+    bool start() noexcept override;
+    bool update() noexcept override;
+    void stop() noexcept override;
+
+    [[nodiscard]] KeyMask get_keys() const noexcept override;
+
+    void render(Framebuffer const& framebuffer) noexcept override;
+
+    void set_sound(bool on) noexcept override;
+
+  private:
+    bool running_{false};
+};
+
+[[nodiscard]] inline bool HeadlessManager::is_running() const noexcept
+{
+    return running_;
+}
+
+} // namespace chip8
+
+#endif // CHIP_8_HEADLESS_MANAGER
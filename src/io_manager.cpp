@@ -7,4 +7,9 @@ IOManager::IOManager() = default;
 
 IOManager::~IOManager() = default;
 
+Command IOManager::poll_command()
+{
+    return Command::NONE;
+}
+
 } // namespace chip8
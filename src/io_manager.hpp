@@ -2,11 +2,25 @@
 #define CHIP8_IO_MANAGER
 
 #include "constants.hpp"
-#include "utility.hpp"
+#include "framebuffer.hpp"
+#include "keypad.hpp"
+
+#include <cstdint>
 
 namespace chip8
 {
 
+// Requests from the user that are handled by the emulator rather than the
+// emulated machine.
+enum class Command : uint8_t
+{
+    NONE,
+    SAVE_STATE,
+    LOAD_STATE,
+    // Sent for every frame the rewind key is held.
+    REWIND
+};
+
 class IOManager
 {
   public:
@@ -21,16 +35,23 @@ class IOManager
 
     [[nodiscard]] virtual bool is_running() const noexcept = 0;
 
-    virtual void fetch_keys(std::array<bool, chip8::input::n_keys>& out_keys,
-                            bool additive) = 0;
+    // Keys pressed as of the last update().
+    [[nodiscard]] virtual KeyMask get_keys() const noexcept = 0;
 
     virtual bool start()  = 0;
     virtual bool update() = 0;
     virtual void stop()   = 0;
 
-    virtual void render(utility::matrix<bool, display::height_size,
-                                        display::width_size> const& pixels) = 0;
-    virtual void play_beep()                                                = 0;
+    // Returns the next command received by update() and not yet polled, NONE
+    // if there is none. The default implementation never receives any.
+    virtual Command poll_command();
+
+    virtual void render(Framebuffer const& framebuffer) = 0;
+
+    // Starts or stops the tone of the sound timer. Unlike the other members,
+    // it may be called from another thread than the one that started the
+    // IOManager, e.g. by the emulation thread of a ThreadedManager.
+    virtual void set_sound(bool on) = 0;
 };
 
 } // namespace chip8
@@ -0,0 +1,671 @@
+#include "jit_cache.hpp"
+
+#include "block_cache.hpp"
+#include "constants.hpp"
+#include "decoder.hpp"
+#include "machine_state.hpp"
+#include "quirks.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <type_traits>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace chip8
+{
+
+namespace
+{
+
+#if defined(__x86_64__)
+
+static_assert(std::is_standard_layout_v<MachineState>,
+              "the compiled code addresses the fields by their offset");
+
+// The general purpose registers used by the compiled code, numbered as in the
+// ModRM byte. RBX holds the MachineState for the whole block, R12 the Cpu and
+// R13 the budget; RAX, RCX and RDX are scratch.
+enum class Reg : uint8_t
+{
+    AX = 0,
+    CX = 1,
+    DX = 2,
+    BX = 3
+};
+
+// Memory operand [base + disp].
+struct Mem
+{
+    Reg base;
+    int32_t disp;
+};
+
+constexpr Mem v(uint8_t x) noexcept
+{
+    return {Reg::BX,
+            static_cast<int32_t>(offsetof(MachineState, registers) + x)};
+}
+
+constexpr Mem field(std::size_t offset) noexcept
+{
+    return {Reg::BX, static_cast<int32_t>(offset)};
+}
+
+constexpr Mem index_field = field(offsetof(MachineState, index));
+constexpr Mem pc_field    = field(offsetof(MachineState, pc));
+constexpr Mem sp_field    = field(offsetof(MachineState, stack_ptr));
+constexpr Mem dt_field    = field(offsetof(MachineState, delay_timer));
+constexpr Mem st_field    = field(offsetof(MachineState, sound_timer));
+constexpr Mem keys_field  = field(offsetof(MachineState, keys));
+// Slot of the stack whose address RCX holds, see stack_slot_address().
+constexpr Mem stack_slot_field{
+    Reg::CX, static_cast<int32_t>(offsetof(MachineState, stack))};
+
+// Condition codes, the low nibble of the Jcc, SETcc and CMOVcc opcodes.
+enum class Cond : uint8_t
+{
+    B  = 0x2,
+    AE = 0x3,
+    E  = 0x4,
+    NE = 0x5
+};
+
+// Appends x86-64 machine code to a buffer large enough for it. Only the few
+// forms of the instructions the translation uses are known.
+class Emitter
+{
+  public:
+    explicit Emitter(uint8_t* code) noexcept;
+
+    [[nodiscard]] std::size_t size() const noexcept;
+
+    void emit(std::initializer_list<uint8_t> bytes) noexcept;
+
+    // Little-endian immediate of the size of T.
+    template <typename T>
+    void imm(T value) noexcept;
+
+    // Instruction with a memory operand: the opcode, the ModRM byte with reg
+    // (a register or an opcode extension) and the displacement.
+    void op_mem(std::initializer_list<uint8_t> opcode, uint8_t reg,
+                Mem mem) noexcept;
+    void op_mem(std::initializer_list<uint8_t> opcode, Reg reg,
+                Mem mem) noexcept;
+
+    // Overwrites the 8-bit displacement of the short jump at the given
+    // position to land at the current end of the code.
+    void land_jump(std::size_t position) noexcept;
+
+  private:
+    uint8_t* code_;
+    std::size_t size_{};
+};
+
+Emitter::Emitter(uint8_t* code) noexcept
+    : code_{code}
+{
+}
+
+std::size_t Emitter::size() const noexcept
+{
+    return size_;
+}
+
+void Emitter::emit(std::initializer_list<uint8_t> bytes) noexcept
+{
+    for (const auto byte : bytes)
+    {
+        code_[size_++] = byte;
+    }
+}
+
+template <typename T>
+void Emitter::imm(T value) noexcept
+{
+    auto bits = static_cast<std::make_unsigned_t<T>>(value);
+    for (std::size_t i = 0; i < sizeof(T); ++i)
+    {
+        code_[size_++] = static_cast<uint8_t>(bits);
+        bits           = static_cast<decltype(bits)>(bits >> memory::byte);
+    }
+}
+
+void Emitter::op_mem(std::initializer_list<uint8_t> opcode, uint8_t reg,
+                     Mem mem) noexcept
+{
+    constexpr uint8_t mod_disp8  = 0x40;
+    constexpr uint8_t mod_disp32 = 0x80;
+
+    const bool short_disp = mem.disp >= INT8_MIN && mem.disp <= INT8_MAX;
+    const auto mod        = short_disp ? mod_disp8 : mod_disp32;
+    emit(opcode);
+    // NOLINTNEXTLINE(hicpp-signed-bitwise)
+    emit({static_cast<uint8_t>(mod | (reg << 3U) |
+                               static_cast<uint8_t>(mem.base))});
+    if (short_disp)
+    {
+        imm(static_cast<int8_t>(mem.disp));
+    }
+    else
+    {
+        imm(mem.disp);
+    }
+}
+
+void Emitter::op_mem(std::initializer_list<uint8_t> opcode, Reg reg,
+                     Mem mem) noexcept
+{
+    op_mem(opcode, static_cast<uint8_t>(reg), mem);
+}
+
+void Emitter::land_jump(std::size_t position) noexcept
+{
+    code_[position + 1] = static_cast<uint8_t>(size_ - (position + 2));
+}
+
+// Emits the code of a block, one instruction after the other, implementing
+// the instructions the way Cpu::execute() does with the quirks policy.
+template <typename Quirks>
+class Translator
+{
+  public:
+    Translator(uint8_t* code, JitHandler handler) noexcept;
+
+    [[nodiscard]] std::size_t size() const noexcept;
+
+    void prologue() noexcept;
+    // Returns with what is left of the budget.
+    void epilogue() noexcept;
+
+    // The instruction at the given address. The pc is not updated unless the
+    // instruction ends the block.
+    void instruction(DecodedInstruction const& instr,
+                     uint16_t address) noexcept;
+
+    // Leaves the pc at the given address.
+    void store_pc(uint16_t address) noexcept;
+
+  private:
+    // Returns before the instruction at the given address once the budget is
+    // spent, otherwise takes one instruction from it.
+    void check_budget(uint16_t address) noexcept;
+
+    // Stores next, or next plus an instruction if the flags satisfy the
+    // condition, in the pc.
+    void skip_if(Cond cond, uint16_t next) noexcept;
+
+    // Loads the address of the slot the stack pointer refers to, minus the
+    // offset of the stack, to RCX.
+    void stack_slot_address() noexcept;
+
+    // Calls the handler of the CPU, with the pc past the instruction.
+    void call_handler(DecodedInstruction const& instr, uint16_t next) noexcept;
+
+    Emitter e_;
+    JitHandler handler_;
+};
+
+template <typename Quirks>
+Translator<Quirks>::Translator(uint8_t* code, JitHandler handler) noexcept
+    : e_{code}, handler_{handler}
+{
+}
+
+template <typename Quirks>
+std::size_t Translator<Quirks>::size() const noexcept
+{
+    return e_.size();
+}
+
+template <typename Quirks>
+void Translator<Quirks>::prologue() noexcept
+{
+    // The three pushes also align the stack on 16 bytes for the calls.
+    e_.emit({0x53});             // push rbx
+    e_.emit({0x41, 0x54});       // push r12
+    e_.emit({0x41, 0x55});       // push r13
+    e_.emit({0x48, 0x89, 0xFB}); // mov rbx, rdi
+    e_.emit({0x49, 0x89, 0xF4}); // mov r12, rsi
+    e_.emit({0x49, 0x89, 0xD5}); // mov r13, rdx
+}
+
+template <typename Quirks>
+void Translator<Quirks>::epilogue() noexcept
+{
+    e_.emit({0x4C, 0x89, 0xE8}); // mov rax, r13
+    e_.emit({0x41, 0x5D});       // pop r13
+    e_.emit({0x41, 0x5C});       // pop r12
+    e_.emit({0x5B});             // pop rbx
+    e_.emit({0xC3});             // ret
+}
+
+template <typename Quirks>
+void Translator<Quirks>::store_pc(uint16_t address) noexcept
+{
+    e_.op_mem({0x66, 0xC7}, 0, pc_field); // mov word [pc], address
+    e_.imm(address);
+}
+
+template <typename Quirks>
+void Translator<Quirks>::check_budget(uint16_t address) noexcept
+{
+    e_.emit({0x4D, 0x85, 0xED}); // test r13, r13
+    const auto jump = e_.size();
+    e_.emit({0x75, 0x00}); // jnz over the exit
+    store_pc(address);
+    epilogue();
+    e_.land_jump(jump);
+    e_.emit({0x49, 0xFF, 0xCD}); // dec r13
+}
+
+template <typename Quirks>
+void Translator<Quirks>::skip_if(Cond cond, uint16_t next) noexcept
+{
+    const auto cmov = static_cast<uint8_t>(0x40 | static_cast<uint8_t>(cond));
+    e_.emit({0xB8}); // mov eax, next
+    e_.imm<uint32_t>(next);
+    e_.emit({0xB9}); // mov ecx, next + instruction_size
+    e_.imm<uint32_t>(next + memory::instruction_size);
+    e_.emit({0x0F, cmov, 0xC1});               // cmovcc eax, ecx
+    e_.op_mem({0x66, 0x89}, Reg::AX, pc_field); // mov [pc], ax
+}
+
+template <typename Quirks>
+void Translator<Quirks>::stack_slot_address() noexcept
+{
+    constexpr auto slot_mask = static_cast<uint8_t>(cpu::stack_size - 1);
+    e_.op_mem({0x0F, 0xB6}, Reg::AX, sp_field); // movzx eax, byte [sp]
+    e_.emit({0x83, 0xE0, slot_mask});           // and eax, slot_mask
+    e_.emit({0x48, 0x8D, 0x0C, 0x43});          // lea rcx, [rbx + rax * 2]
+}
+
+template <typename Quirks>
+void Translator<Quirks>::call_handler(DecodedInstruction const& instr,
+                                      uint16_t next) noexcept
+{
+    store_pc(next);
+    e_.emit({0x4C, 0x89, 0xE7}); // mov rdi, r12
+    e_.emit({0xBE});             // mov esi, opcode
+    e_.imm<uint32_t>(instr.opcode);
+    e_.emit({0x48, 0xB8}); // mov rax, handler
+    e_.imm(std::bit_cast<uint64_t>(handler_));
+    e_.emit({0xFF, 0xD0}); // call rax
+}
+
+template <typename Quirks>
+void Translator<Quirks>::instruction(DecodedInstruction const& instr,
+                                     uint16_t address) noexcept
+{
+    // NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+    const auto vf = v(0xf);
+    const auto vx = v(instr.x);
+    const auto vy = v(instr.y);
+    const auto next =
+        static_cast<uint16_t>(address + memory::instruction_size);
+
+    check_budget(address);
+
+    // NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers)
+    switch (instr.op)
+    {
+    case Op::RET:
+        stack_slot_address();
+        e_.op_mem({0x80}, 5, sp_field); // sub byte [sp], 1
+        e_.imm<uint8_t>(1);
+        e_.op_mem({0x0F, 0xB7}, Reg::AX, stack_slot_field); // movzx eax, [slot]
+        e_.op_mem({0x66, 0x89}, Reg::AX, pc_field);         // mov [pc], ax
+        break;
+    case Op::JP_NNN:
+        store_pc(instr.nnn);
+        break;
+    case Op::CALL:
+        e_.op_mem({0x80}, 0, sp_field); // add byte [sp], 1
+        e_.imm<uint8_t>(1);
+        stack_slot_address();
+        e_.op_mem({0x66, 0xC7}, 0, stack_slot_field); // mov word [slot], next
+        e_.imm(next);
+        store_pc(instr.nnn);
+        break;
+    case Op::SE_VX_NN:
+    case Op::SNE_VX_NN:
+        e_.op_mem({0x80}, 7, vx); // cmp byte [vx], nn
+        e_.imm(instr.nn);
+        skip_if(instr.op == Op::SE_VX_NN ? Cond::E : Cond::NE, next);
+        break;
+    case Op::SE_VX_VY:
+    case Op::SNE_VX_VY:
+        e_.op_mem({0x8A}, Reg::AX, vx); // mov al, [vx]
+        e_.op_mem({0x3A}, Reg::AX, vy); // cmp al, [vy]
+        skip_if(instr.op == Op::SE_VX_VY ? Cond::E : Cond::NE, next);
+        break;
+    case Op::LD_VX_NN:
+        e_.op_mem({0xC6}, 0, vx); // mov byte [vx], nn
+        e_.imm(instr.nn);
+        break;
+    case Op::ADD_VX_NN:
+        e_.op_mem({0x80}, 0, vx); // add byte [vx], nn
+        e_.imm(instr.nn);
+        break;
+    case Op::LD_VX_VY:
+        e_.op_mem({0x8A}, Reg::AX, vy); // mov al, [vy]
+        e_.op_mem({0x88}, Reg::AX, vx); // mov [vx], al
+        break;
+    case Op::OR_VX_VY:
+    case Op::AND_VX_VY:
+    case Op::XOR_VX_VY: {
+        const uint8_t logic = instr.op == Op::OR_VX_VY    ? 0x08
+                              : instr.op == Op::AND_VX_VY ? 0x20
+                                                          : 0x30;
+        e_.op_mem({0x8A}, Reg::AX, vy);  // mov al, [vy]
+        e_.op_mem({logic}, Reg::AX, vx); // or/and/xor [vx], al
+        if constexpr (Quirks::logic_resets_vf)
+        {
+            e_.op_mem({0xC6}, 0, vf); // mov byte [vf], 0
+            e_.imm<uint8_t>(0);
+        }
+        break;
+    }
+    case Op::ADD_VX_VY:
+        e_.op_mem({0x8A}, Reg::AX, vy); // mov al, [vy]
+        e_.op_mem({0x00}, Reg::AX, vx); // add [vx], al
+        e_.emit({0x0F, 0x92, 0xC1});    // setc cl
+        e_.op_mem({0x88}, Reg::CX, vf); // mov [vf], cl
+        break;
+    case Op::SUB_VX_VY:
+    case Op::SUBN_VX_VY: {
+        const bool sub = instr.op == Op::SUB_VX_VY;
+        e_.op_mem({0x8A}, Reg::AX, sub ? vx : vy); // mov al, minuend
+        e_.op_mem({0x2A}, Reg::AX, sub ? vy : vx); // sub al, subtrahend
+        e_.emit({0x0F, 0x93, 0xC1});               // setae cl
+        e_.op_mem({0x88}, Reg::AX, vx);            // mov [vx], al
+        e_.op_mem({0x88}, Reg::CX, vf);            // mov [vf], cl
+        break;
+    }
+    case Op::SHR_VX_VY:
+        e_.op_mem({0x8A}, Reg::AX, Quirks::shift_vy ? vy : vx); // mov al, src
+        e_.emit({0x88, 0xC1});                                  // mov cl, al
+        e_.emit({0x80, 0xE1, 0x01});                            // and cl, 1
+        e_.emit({0xD0, 0xE8});                                  // shr al, 1
+        e_.op_mem({0x88}, Reg::AX, vx); // mov [vx], al
+        e_.op_mem({0x88}, Reg::CX, vf); // mov [vf], cl
+        break;
+    case Op::SHL_VX_VY:
+        e_.op_mem({0x8A}, Reg::AX, Quirks::shift_vy ? vy : vx); // mov al, src
+        e_.emit({0x88, 0xC1});                                  // mov cl, al
+        e_.emit({0xC0, 0xE9, 0x07});                            // shr cl, 7
+        e_.emit({0xD0, 0xE0});                                  // shl al, 1
+        e_.op_mem({0x88}, Reg::AX, vx); // mov [vx], al
+        e_.op_mem({0x88}, Reg::CX, vf); // mov [vf], cl
+        break;
+    case Op::LD_I_NNN:
+        e_.op_mem({0x66, 0xC7}, 0, index_field); // mov word [index], nnn
+        e_.imm(instr.nnn);
+        break;
+    case Op::JP_V0_NNN:
+        // x is the highest nibble of nnn.
+        e_.op_mem({0x0F, 0xB6}, Reg::AX,
+                  Quirks::jump_vx ? vx : v(0)); // movzx eax, byte [base]
+        e_.emit({0x05}); // add eax, nnn
+        e_.imm<uint32_t>(instr.nnn);
+        e_.op_mem({0x66, 0x89}, Reg::AX, pc_field); // mov [pc], ax
+        break;
+    case Op::SKP_VX:
+    case Op::NSKP_VX:
+        e_.op_mem({0x0F, 0xB6}, Reg::CX, vx);         // movzx ecx, byte [vx]
+        e_.emit({0x83, 0xE1, input::key_mask});       // and ecx, key_mask
+        e_.op_mem({0x0F, 0xB7}, Reg::AX, keys_field); // movzx eax, [keys]
+        e_.emit({0x0F, 0xA3, 0xC8});                  // bt eax, ecx
+        skip_if(instr.op == Op::SKP_VX ? Cond::B : Cond::AE, next);
+        break;
+    case Op::LD_VX_DT:
+        e_.op_mem({0x8A}, Reg::AX, dt_field); // mov al, [dt]
+        e_.op_mem({0x88}, Reg::AX, vx);       // mov [vx], al
+        store_pc(next);
+        break;
+    case Op::LD_DT_VX:
+    case Op::LD_ST_VX:
+        e_.op_mem({0x8A}, Reg::AX, vx); // mov al, [vx]
+        e_.op_mem({0x88}, Reg::AX,
+                  instr.op == Op::LD_DT_VX ? dt_field
+                                           : st_field); // mov [timer], al
+        break;
+    case Op::ADD_I_VX:
+        e_.op_mem({0x0F, 0xB6}, Reg::AX, vx);          // movzx eax, byte [vx]
+        e_.op_mem({0x66, 0x01}, Reg::AX, index_field); // add [index], ax
+        break;
+    case Op::LD_F_VX:
+        e_.op_mem({0x0F, 0xB6}, Reg::AX, vx);       // movzx eax, byte [vx]
+        e_.emit({0x6B, 0xC0, font::letter_size});   // imul eax, eax, size
+        e_.emit({0x05});                            // add eax, font_address
+        e_.imm<uint32_t>(memory::font_address);
+        e_.op_mem({0x66, 0x89}, Reg::AX, index_field); // mov [index], ax
+        break;
+    case Op::UNDECODED:
+    case Op::EMPTY:
+    case Op::UNKNOWN:
+    case Op::SYS_ADDR:
+    case Op::CLS:
+    case Op::RND_VX_NN:
+    case Op::DRW_VX_VY_N:
+    case Op::LD_VX_K:
+    case Op::LD_B_VX:
+    case Op::LD_I_VX:
+    case Op::LD_VX_I:
+        call_handler(instr, next);
+        break;
+    }
+    // NOLINTEND(cppcoreguidelines-avoid-magic-numbers)
+
+    if (ends_block(instr.op))
+    {
+        epilogue();
+    }
+}
+
+// Maps the arena pages overlapping [offset, offset + size) with the given
+// protection.
+bool protect(uint8_t* arena, std::size_t offset, std::size_t size,
+             int protection) noexcept
+{
+    static const auto page_size =
+        static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+
+    const auto first = offset - offset % page_size;
+    const auto last  = std::min(
+        (offset + size + page_size - 1) / page_size * page_size,
+        jit::arena_size);
+    return mprotect(arena + first, last - first, protection) == 0;
+}
+
+#endif
+
+} // namespace
+
+JitCache::JitCache(uint8_t* arena) noexcept
+    : arena_{arena}
+{
+}
+
+JitCache::~JitCache()
+{
+    munmap(arena_, jit::arena_size);
+}
+
+JitBlock JitCache::lookup(uint16_t address,
+                          std::array<uint8_t, memory::size> const& mem,
+                          Profile profile, JitHandler handler) noexcept
+{
+    if (address >= memory::size)
+    {
+        return {};
+    }
+    if (profile != profile_)
+    {
+        clear();
+        profile_ = profile;
+    }
+
+    const auto& block = blocks_[address];
+    if (block.valid)
+    {
+        return {.function    = function_at(block.offset),
+                .closes_loop = block.closes_loop};
+    }
+    return translate(address, mem, handler);
+}
+
+void JitCache::invalidate(uint16_t address, uint16_t size) noexcept
+{
+    const int last = std::min<int>(address + size, memory::size);
+
+    bool code = false;
+    for (int i = address; i < last && !code; ++i)
+    {
+        code = code_[i];
+    }
+    if (!code)
+    {
+        return;
+    }
+
+    // Only blocks starting at most blocks::max_size instructions before the
+    // written range can overlap it.
+    constexpr int max_block_bytes =
+        blocks::max_size * memory::instruction_size;
+
+    const int first = std::max(0, address - max_block_bytes + 1);
+    for (int start = first; start < last; ++start)
+    {
+        auto& block = blocks_[start];
+        const int end = start + block.size * memory::instruction_size;
+        if (block.valid && end > address)
+        {
+            block.valid = false;
+        }
+    }
+}
+
+void JitCache::clear() noexcept
+{
+    std::ranges::fill(blocks_, Block{});
+    code_.reset();
+    arena_used_ = 0;
+}
+
+JitFunction JitCache::function_at(std::size_t offset) const noexcept
+{
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    return reinterpret_cast<JitFunction>(arena_ + offset);
+}
+
+JitBlock JitCache::translate(uint16_t address,
+                             std::array<uint8_t, memory::size> const& mem,
+                             JitHandler handler) noexcept
+{
+#if defined(__x86_64__)
+    if (address + 1 >= memory::size)
+    {
+        return {};
+    }
+
+    // The prologue and the return after the last instruction take less than
+    // one more instruction.
+    constexpr std::size_t max_code_size =
+        (blocks::max_size + 1) * jit::max_instruction_size;
+    if (arena_used_ + max_code_size > jit::arena_size)
+    {
+        clear();
+    }
+
+    const auto offset = arena_used_;
+    if (!protect(arena_, offset, max_code_size, PROT_READ | PROT_WRITE))
+    {
+        return {};
+    }
+
+    uint8_t size    = 0;
+    Op last         = Op::UNDECODED;
+    const auto code = visit(profile_, [&](auto quirks) {
+        Translator<decltype(quirks)> translator(arena_ + offset, handler);
+        translator.prologue();
+        auto pc = address;
+        for (; pc + 1 < memory::size && size < blocks::max_size;
+             pc += memory::instruction_size)
+        {
+            // NOLINTNEXTLINE(hicpp-signed-bitwise)
+            const uint16_t opcode = (mem[pc] << memory::byte) | mem[pc + 1];
+            const auto instr      = decode(opcode);
+            translator.instruction(instr, pc);
+            last = instr.op;
+            ++size;
+            if (ends_block(instr.op))
+            {
+                return translator.size();
+            }
+        }
+        translator.store_pc(pc);
+        translator.epilogue();
+        return translator.size();
+    });
+    assert(code <= max_code_size);
+
+    if (!protect(arena_, offset, code, PROT_READ | PROT_EXEC))
+    {
+        return {};
+    }
+    // The next block starts on its own cache line.
+    arena_used_ += (code + host::cache_line - 1) / host::cache_line *
+                   host::cache_line;
+
+    const bool closes_loop = last == Op::JP_NNN || last == Op::LD_VX_K;
+    const auto end = std::min<int>(address + size * memory::instruction_size,
+                                   memory::size);
+    for (int i = address; i < end; ++i)
+    {
+        code_.set(i);
+    }
+
+    blocks_[address] = Block{.offset      = static_cast<uint32_t>(offset),
+                             .size        = size,
+                             .closes_loop = closes_loop,
+                             .valid       = true};
+    return {.function = function_at(offset), .closes_loop = closes_loop};
+#else
+    static_cast<void>(address);
+    static_cast<void>(mem);
+    static_cast<void>(handler);
+    return {};
+#endif
+}
+
+std::unique_ptr<JitCache> make_jit_cache()
+{
+#if defined(__x86_64__)
+    void* arena = mmap(nullptr, jit::arena_size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (arena == MAP_FAILED)
+    {
+        return nullptr;
+    }
+    auto* bytes = static_cast<uint8_t*>(arena);
+    // Some systems refuse to make writable memory executable.
+    if (!protect(bytes, 0, jit::arena_size, PROT_READ | PROT_EXEC))
+    {
+        munmap(arena, jit::arena_size);
+        return nullptr;
+    }
+    return std::unique_ptr<JitCache>(new JitCache(bytes));
+#else
+    return nullptr;
+#endif
+}
+
+} // namespace chip8
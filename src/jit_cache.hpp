@@ -0,0 +1,104 @@
+#ifndef CHIP_8_JIT_CACHE
+#define CHIP_8_JIT_CACHE
+
+#include "constants.hpp"
+#include "quirks.hpp"
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace chip8
+{
+
+class Cpu;
+struct MachineState;
+
+// Compiled block: executes at most budget of its instructions on the state,
+// leaves the address of the next instruction in the pc and returns what is
+// left of the budget.
+using JitFunction = uint64_t (*)(MachineState* state, Cpu* cpu,
+                                 uint64_t budget);
+
+// Called by the compiled code for the instructions it does not translate,
+// with the pc of the Cpu already past the instruction.
+using JitHandler = void (*)(Cpu* cpu, uint16_t opcode) noexcept;
+
+struct JitBlock
+{
+    JitFunction function{};
+    // Whether the block ends with a jump or Fx0A, with which every idle loop
+    // goes back to its start.
+    bool closes_loop{};
+};
+
+// Translates the basic blocks of the program into x86-64 machine code stored
+// in an arena of executable memory, so that the CPU runs them natively. The
+// blocks end where those of BlockCache end. The arithmetic, the loads, the
+// jumps, the calls, the skips and the timers are translated inline, the
+// other instructions call back into the handlers of the CPU.
+//
+// The arena is only writable while a block is being translated.
+class JitCache
+{
+  public:
+    JitCache(JitCache const&) = delete;
+    JitCache(JitCache&&)      = delete;
+
+    ~JitCache();
+
+    JitCache& operator=(JitCache const&) = delete;
+    JitCache& operator=(JitCache&&)      = delete;
+
+    // Returns the block starting at the given address, translating it for
+    // the profile if it is not cached yet. Its function is nullptr if the
+    // address is past the end of memory or holds no complete instruction. The
+    // blocks cached for another profile are dropped.
+    [[nodiscard]] JitBlock lookup(
+        uint16_t address, std::array<uint8_t, memory::size> const& mem,
+        Profile profile, JitHandler handler) noexcept;
+
+    // Drops all the blocks overlapping the given memory range.
+    void invalidate(uint16_t address, uint16_t size) noexcept;
+
+    void clear() noexcept;
+
+  private:
+    friend std::unique_ptr<JitCache> make_jit_cache();
+
+    struct Block
+    {
+        uint32_t offset{};
+        uint8_t size{};
+        bool closes_loop{};
+        bool valid{false};
+    };
+
+    explicit JitCache(uint8_t* arena) noexcept;
+
+    [[nodiscard]] JitFunction function_at(std::size_t offset) const noexcept;
+
+    JitBlock translate(uint16_t address,
+                       std::array<uint8_t, memory::size> const& mem,
+                       JitHandler handler) noexcept;
+
+    std::array<Block, memory::size> blocks_{};
+    // The bytes of memory translated into some block since the last clear(),
+    // so that writing data elsewhere skips looking for blocks to drop.
+    std::bitset<memory::size> code_{};
+
+    uint8_t* arena_;
+    std::size_t arena_used_{};
+
+    Profile profile_{Profile::DEFAULT};
+};
+
+// A JitCache, or nullptr if the host is not x86-64 or does not let executable
+// memory be mapped, in which case the CPU runs a BlockCache instead.
+[[nodiscard]] std::unique_ptr<JitCache> make_jit_cache();
+
+} // namespace chip8
+
+#endif // CHIP_8_JIT_CACHE
@@ -0,0 +1,57 @@
+#include "keypad.hpp"
+
+#include "constants.hpp"
+
+#include <array>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace chip8
+{
+
+KeyMap::KeyMap() noexcept
+{
+    assign(input::default_layout);
+}
+
+void KeyMap::assign(std::string_view layout) noexcept
+{
+    bits_.fill(0);
+    for (uint8_t key = 0; key < input::n_keys; ++key)
+    {
+        const auto host = static_cast<unsigned char>(
+            std::tolower(static_cast<unsigned char>(layout[key])));
+        // NOLINTNEXTLINE(hicpp-signed-bitwise)
+        bits_[host]  = static_cast<KeyMask>(1U << key);
+        layout_[key] = static_cast<char>(host);
+    }
+}
+
+std::optional<KeyMap> parse_key_map(std::string_view layout)
+{
+    if (layout.size() != input::n_keys)
+    {
+        return std::nullopt;
+    }
+
+    std::array<bool, KeyMap::n_keycodes> used{};
+    for (const char c : layout)
+    {
+        const auto host = static_cast<unsigned char>(
+            std::tolower(static_cast<unsigned char>(c)));
+        if (std::isgraph(host) == 0 || used[host])
+        {
+            return std::nullopt;
+        }
+        used[host] = true;
+    }
+
+    KeyMap map;
+    map.assign(layout);
+    return map;
+}
+
+} // namespace chip8
@@ -0,0 +1,71 @@
+#ifndef CHIP_8_KEYPAD
+#define CHIP_8_KEYPAD
+
+#include "constants.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace chip8
+{
+
+// State of the keypad, bit i is set if key i is pressed.
+using KeyMask = uint16_t;
+
+// Whether the given key is pressed. Only the low 4 bits of key are used, as
+// the CHIP-8 does with the value of Vx in Ex9E and ExA1.
+[[nodiscard]] constexpr bool is_pressed(KeyMask keys, uint8_t key) noexcept
+{
+    return ((keys >> (key & input::key_mask)) & 1U) != 0;
+}
+
+// Maps the host keycodes to the keys of the keypad through a lookup table.
+// Only keycodes below n_keycodes can be mapped, which covers the letters,
+// digits and punctuation keys, whose SDL keycodes are their ASCII values.
+class KeyMap
+{
+  public:
+    static constexpr std::size_t n_keycodes = 256;
+
+    // The default layout, input::default_layout.
+    KeyMap() noexcept;
+
+    // Bit of the keypad key mapped to keycode, 0 if there is none.
+    [[nodiscard]] KeyMask bit_of(int32_t keycode) const noexcept;
+
+    // Host key mapped to the given keypad key.
+    [[nodiscard]] char key_of(uint8_t key) const noexcept;
+
+  private:
+    friend std::optional<KeyMap> parse_key_map(std::string_view layout);
+
+    void assign(std::string_view layout) noexcept;
+
+    std::array<KeyMask, n_keycodes> bits_{};
+    std::array<char, input::n_keys> layout_{};
+};
+
+inline KeyMask KeyMap::bit_of(int32_t keycode) const noexcept
+{
+    return keycode >= 0 && static_cast<std::size_t>(keycode) < n_keycodes
+               ? bits_[static_cast<std::size_t>(keycode)]
+               : KeyMask{0};
+}
+
+inline char KeyMap::key_of(uint8_t key) const noexcept
+{
+    return layout_[key & input::key_mask];
+}
+
+// Builds a key map from the host keys of the keypad keys 0 to F, in this
+// order, e.g. input::default_layout. Letters are case insensitive. Returns
+// std::nullopt unless the layout has one distinct printable ASCII character
+// per key.
+std::optional<KeyMap> parse_key_map(std::string_view layout);
+
+} // namespace chip8
+
+#endif // CHIP_8_KEYPAD
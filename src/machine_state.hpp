@@ -0,0 +1,57 @@
+#ifndef CHIP_8_MACHINE_STATE
+#define CHIP_8_MACHINE_STATE
+
+#include "constants.hpp"
+#include "framebuffer.hpp"
+#include "keypad.hpp"
+#include "random.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace chip8
+{
+
+// Everything the emulated machine is made of, in one flat block that Memory,
+// Display and Cpu work on rather than keeping their own copies. It holds no
+// pointer, so copying the struct clones the machine.
+//
+// The registers, the stack and the timers, which almost every instruction
+// touches, share the first cache line; the framebuffer and the memory start
+// on their own lines.
+struct alignas(host::cache_line) MachineState
+{
+    std::array<uint8_t, cpu::n_registers> registers{};
+    std::array<uint16_t, cpu::stack_size> stack{};
+    uint16_t index{};
+    uint16_t pc{memory::free_address};
+    int8_t stack_ptr{-1};
+    uint8_t delay_timer{};
+    uint8_t sound_timer{};
+    // Keys read by the instructions in the current frame.
+    KeyMask keys{};
+    // Drawn from by Cxkk.
+    Random random{};
+
+    alignas(host::cache_line) Framebuffer framebuffer{};
+    alignas(host::cache_line) std::array<uint8_t, memory::size> memory{};
+};
+
+static_assert(std::is_trivially_copyable_v<MachineState>);
+static_assert(offsetof(MachineState, keys) + sizeof(KeyMask) <=
+                  host::cache_line,
+              "the registers must fit in the first cache line");
+
+// Slot of the stack a stack pointer refers to. The pointer wraps around, so
+// that overflowing or underflowing the stack stays within it.
+[[nodiscard]] constexpr std::size_t stack_slot(int8_t stack_ptr) noexcept
+{
+    // NOLINTNEXTLINE(hicpp-signed-bitwise)
+    return static_cast<uint8_t>(stack_ptr) & (cpu::stack_size - 1U);
+}
+
+} // namespace chip8
+
+#endif // CHIP_8_MACHINE_STATE
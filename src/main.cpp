@@ -1,13 +1,25 @@
 #include "chip8.hpp"
+#include "constants.hpp"
+#include "headless_manager.hpp"
+#include "io_manager.hpp"
+#include "op_stats.hpp"
+#include "recording.hpp"
+#include "rewind.hpp"
+#include "save_state.hpp"
 #include "sdl2manager.hpp"
+#include "threaded_manager.hpp"
+#include "trace.hpp"
 #include "utility.hpp"
 
+#include <cstdint>
 #include <cstdlib>
 #include <expected>
+#include <fstream>
 #include <iostream>
 #include <memory>
 #include <optional>
 #include <print>
+#include <thread>
 #include <variant>
 
 namespace
@@ -40,6 +52,18 @@ bool handle_load_rom_result(std::expected<void, chip8::LoadRomError> res)
     return false;
 }
 
+bool handle_load_state_result(std::expected<void, chip8::StateError> res)
+{
+    if (res.has_value())
+    {
+        std::println("State loaded successfully");
+        return true;
+    }
+
+    std::println(std::cerr, "Error: {}", chip8::to_string(res.error()));
+    return false;
+}
+
 // NOLINTNEXTLINE(modernize-avoid-c-arrays)
 std::optional<argparse::Options> parse_args(int argc, char* argv[], int& ret)
 {
@@ -60,18 +84,209 @@ std::optional<argparse::Options> parse_args(int argc, char* argv[], int& ret)
     return std::nullopt;
 }
 
-int run_emulator(const chip8::utility::argparse::Options& opts)
+std::unique_ptr<chip8::IOManager> make_io_manager(
+    const chip8::utility::argparse::Options& opts)
+{
+    if (opts.headless)
+    {
+        return std::make_unique<chip8::HeadlessManager>();
+    }
+    return std::make_unique<chip8::Sdl2Manager>(
+        chip8::Sdl2Manager::Config{.key_map = opts.key_map});
+}
+
+// Runs the emulation on its own thread while this one presents the frames
+// and polls the input, if there is a presenter, else on this thread.
+chip8::RunStats run_machine(chip8::Chip8& emulator,
+                            chip8::ThreadedManager* presenter,
+                            chip8::RunMode mode, uint64_t cycle_budget)
+{
+    if (!presenter)
+    {
+        return emulator.start(mode, cycle_budget);
+    }
+
+    chip8::RunStats stats;
+    {
+        std::jthread emulation(
+            [&] { stats = emulator.start(mode, cycle_budget); });
+        presenter->present();
+    }
+    return stats;
+}
+
+bool load_machine(chip8::Chip8& emulator,
+                  const chip8::utility::argparse::Options& opts)
 {
-    auto io = std::make_unique<chip8::Sdl2Manager>();
-    chip8::Chip8 emulator(std::move(io), opts.rate);
+    if (!opts.replay.empty())
+    {
+        if (auto res = emulator.start_replay(opts.replay, opts.seek); !res)
+        {
+            std::println(std::cerr, "Error: {}", chip8::to_string(res.error()));
+            return false;
+        }
+        return true;
+    }
 
     if (auto load_res = emulator.load_rom(opts.rom);
         !handle_load_rom_result(load_res))
     {
+        return false;
+    }
+
+    if (!opts.state.empty())
+    {
+        if (auto state_res = emulator.load_state(opts.state);
+            !handle_load_state_result(state_res))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int handle_replay_result(chip8::ReplayResult result)
+{
+    switch (result)
+    {
+        using enum chip8::ReplayResult;
+    case MATCH:
+        std::println("Replay matches the recording");
+        return EXIT_SUCCESS;
+    case MISMATCH:
+        std::println(std::cerr, "Error: replay diverged from the recording");
         return EXIT_FAILURE;
+    case UNVERIFIED:
+        std::println("Recording was interrupted, the replay is not verified");
+        return EXIT_SUCCESS;
+    }
+    return EXIT_FAILURE;
+}
+
+bool report_op_stats(const chip8::OpStats& stats,
+                     const chip8::utility::argparse::Options& opts)
+{
+    if (opts.stats)
+    {
+        std::print("{}", chip8::format_table(stats));
     }
 
-    emulator.start();
+    if (!opts.stats_json.empty())
+    {
+        std::ofstream file(opts.stats_json);
+        file << chip8::format_json(stats);
+        if (!file)
+        {
+            std::println(std::cerr, "Error: cannot write the stats to {}",
+                         opts.stats_json);
+            return false;
+        }
+    }
+    return true;
+}
+
+int run_emulator(const chip8::utility::argparse::Options& opts)
+{
+    auto io = make_io_manager(opts);
+
+    // The window is owned by this thread, the emulation runs on another one.
+    chip8::ThreadedManager* presenter = nullptr;
+    if (!opts.headless)
+    {
+        auto threaded = std::make_unique<chip8::ThreadedManager>(std::move(io));
+        presenter     = threaded.get();
+        io            = std::move(threaded);
+    }
+
+    chip8::Chip8 emulator(std::move(io), opts.rate, opts.cpu, opts.profile);
+    if (opts.seed)
+    {
+        emulator.seed(*opts.seed);
+    }
+
+    if (!load_machine(emulator, opts))
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Without a window there is no way to hold the rewind key.
+    if (!opts.headless && opts.rewind != 0)
+    {
+        const auto frames =
+            static_cast<uint32_t>(opts.rewind * chip8::timer::fps);
+        emulator.enable_rewind(chip8::RewindConfig{
+            .frames            = frames,
+            .keyframe_interval = chip8::rewind::keyframe_interval,
+            .journal_size =
+                frames * chip8::rewind::journal_entries_per_frame});
+    }
+
+    if (!opts.record.empty())
+    {
+        if (auto res = emulator.start_recording(opts.record); !res)
+        {
+            std::println(std::cerr, "Error: {}", chip8::to_string(res.error()));
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (opts.stats || !opts.stats_json.empty())
+    {
+        emulator.enable_op_stats();
+    }
+
+    if (!opts.trace.empty())
+    {
+        const chip8::TracerConfig config{
+            .capacity = chip8::trace::ring_capacity,
+            .overflow = opts.trace_overflow};
+        if (auto res = emulator.start_trace(opts.trace, config); !res)
+        {
+            std::println(std::cerr, "Error: {}", chip8::to_string(res.error()));
+            return EXIT_FAILURE;
+        }
+    }
+
+    const auto mode =
+        opts.turbo ? chip8::RunMode::TURBO : chip8::RunMode::PACED;
+
+    const auto stats = run_machine(emulator, presenter, mode, opts.cycles);
+
+    if (opts.headless || opts.turbo)
+    {
+        std::println("Executed {} instructions in {:.3f}s ({:.0f} IPS)",
+                     stats.cycles, stats.elapsed.count(), stats.ips());
+    }
+
+    if (!opts.trace.empty())
+    {
+        const auto dropped = emulator.finish_trace();
+        if (!dropped)
+        {
+            std::println(std::cerr, "Error: {}",
+                         chip8::to_string(dropped.error()));
+            return EXIT_FAILURE;
+        }
+        if (*dropped != 0)
+        {
+            std::println(std::cerr,
+                         "Warning: {} trace records dropped, the trace could "
+                         "not be written fast enough",
+                         *dropped);
+        }
+    }
+
+    if (const auto* op_stats = emulator.get_op_stats();
+        op_stats && !report_op_stats(*op_stats, opts))
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (!opts.replay.empty())
+    {
+        return handle_replay_result(emulator.check_replay());
+    }
 
     return EXIT_SUCCESS;
 }
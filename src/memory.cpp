@@ -1,22 +1,27 @@
 #include "memory.hpp"
 
 #include "constants.hpp"
+#include "machine_state.hpp"
 
 #include <algorithm>
+#include <cassert>
 #include <cstdint>
 #include <span>
 
 namespace chip8
 {
 
-Memory::Memory()
+Memory::Memory(MachineState* state) : state_{state}
 {
-    std::ranges::copy(font::built_in, data_.begin() + memory::font_address);
+    assert(state_);
+
+    std::ranges::copy(font::built_in,
+                      state_->memory.begin() + memory::font_address);
 }
 
-void Memory::load(std::span<uint8_t> values)
+void Memory::load(std::span<const uint8_t> values)
 {
-    std::ranges::copy(values, data_.begin() + memory::free_address);
+    std::ranges::copy(values, state_->memory.begin() + memory::free_address);
 }
 
 } // namespace chip8
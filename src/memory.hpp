@@ -2,6 +2,7 @@
 #define CHIP_8_MEMORY
 
 #include "constants.hpp"
+#include "machine_state.hpp"
 
 #include <array>
 #include <cstdint>
@@ -10,30 +11,32 @@
 namespace chip8
 {
 
+// The memory of a MachineState.
 class Memory
 {
   public:
-    Memory();
+    // Copies the font to the memory of the state.
+    explicit Memory(MachineState* state);
 
-    void load(std::span<uint8_t> values);
+    void load(std::span<const uint8_t> values);
 
     [[nodiscard]] const std::array<uint8_t, memory::size>& get_data()
         const noexcept;
     [[nodiscard]] std::array<uint8_t, memory::size>& get_data() noexcept;
 
   private:
-    std::array<uint8_t, memory::size> data_{};
+    MachineState* state_;
 };
 
 inline const std::array<uint8_t, memory::size>& Memory::get_data()
     const noexcept
 {
-    return data_;
+    return state_->memory;
 }
 
 inline std::array<uint8_t, memory::size>& Memory::get_data() noexcept
 {
-    return data_;
+    return state_->memory;
 }
 
 }; // namespace chip8
@@ -0,0 +1,254 @@
+#include "op_stats.hpp"
+
+#include "decoder.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace chip8
+{
+
+namespace
+{
+
+struct Row
+{
+    Op op{};
+    // With the net time.
+    OpStats::Entry entry{};
+};
+
+// The executed Ops, from the one that took the most time.
+std::vector<Row> sorted_rows(OpStats const& stats)
+{
+    std::vector<Row> rows;
+    for (std::size_t i = 0; i < stats.ops.size(); ++i)
+    {
+        auto const& entry = stats.ops[i];
+        if (entry.count != 0)
+        {
+            rows.push_back(Row{
+                .op    = static_cast<Op>(i),
+                .entry = {.count = entry.count,
+                          .time  = stats.net_time(entry)}});
+        }
+    }
+    std::ranges::sort(rows, [](Row const& a, Row const& b) {
+        return a.entry.time != b.entry.time ? a.entry.time > b.entry.time
+                                            : a.entry.count > b.entry.count;
+    });
+    return rows;
+}
+
+double percent(uint64_t part, uint64_t total) noexcept
+{
+    constexpr double hundred = 100.0;
+    return total == 0 ? 0.0
+                      : hundred * static_cast<double>(part) /
+                            static_cast<double>(total);
+}
+
+double ns_per_op(OpStats::Entry const& entry) noexcept
+{
+    return entry.count == 0 ? 0.0
+                            : static_cast<double>(entry.time.count()) /
+                                  static_cast<double>(entry.count);
+}
+
+// Shortest of many back to back readings of the clock, as done around every
+// profiled instruction.
+std::chrono::duration<double, std::nano> measure_clock_overhead() noexcept
+{
+    using clock = std::chrono::steady_clock;
+
+    constexpr int samples = 1000;
+
+    auto overhead = clock::duration::max();
+    for (int i = 0; i < samples; ++i)
+    {
+        const auto start = clock::now();
+        overhead         = std::min(overhead, clock::now() - start);
+    }
+    return overhead;
+}
+
+} // namespace
+
+OpStats::OpStats() : clock_overhead{measure_clock_overhead()}
+{
+}
+
+std::chrono::nanoseconds OpStats::net_time(Entry const& entry) const noexcept
+{
+    const auto overhead =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            clock_overhead * static_cast<double>(entry.count));
+    return std::max(entry.time - overhead, std::chrono::nanoseconds{0});
+}
+
+uint64_t OpStats::total_count() const noexcept
+{
+    uint64_t total = 0;
+    for (auto const& entry : ops)
+    {
+        total += entry.count;
+    }
+    return total;
+}
+
+std::chrono::nanoseconds OpStats::total_time() const noexcept
+{
+    std::chrono::nanoseconds total{};
+    for (auto const& entry : ops)
+    {
+        total += net_time(entry);
+    }
+    return total;
+}
+
+std::string_view to_string(Op op) noexcept
+{
+    switch (op)
+    {
+        using enum Op;
+    case UNDECODED:
+        return "undecoded";
+    case EMPTY:
+        return "0000";
+    case UNKNOWN:
+        return "unknown";
+    case SYS_ADDR:
+        return "0nnn";
+    case CLS:
+        return "00e0";
+    case RET:
+        return "00ee";
+    case JP_NNN:
+        return "1nnn";
+    case CALL:
+        return "2nnn";
+    case SE_VX_NN:
+        return "3xkk";
+    case SNE_VX_NN:
+        return "4xkk";
+    case SE_VX_VY:
+        return "5xy0";
+    case LD_VX_NN:
+        return "6xkk";
+    case ADD_VX_NN:
+        return "7xkk";
+    case LD_VX_VY:
+        return "8xy0";
+    case OR_VX_VY:
+        return "8xy1";
+    case AND_VX_VY:
+        return "8xy2";
+    case XOR_VX_VY:
+        return "8xy3";
+    case ADD_VX_VY:
+        return "8xy4";
+    case SUB_VX_VY:
+        return "8xy5";
+    case SHR_VX_VY:
+        return "8xy6";
+    case SUBN_VX_VY:
+        return "8xy7";
+    case SHL_VX_VY:
+        return "8xye";
+    case SNE_VX_VY:
+        return "9xy0";
+    case LD_I_NNN:
+        return "annn";
+    case JP_V0_NNN:
+        return "bnnn";
+    case RND_VX_NN:
+        return "cxkk";
+    case DRW_VX_VY_N:
+        return "dxyn";
+    case SKP_VX:
+        return "ex9e";
+    case NSKP_VX:
+        return "exa1";
+    case LD_VX_DT:
+        return "fx07";
+    case LD_VX_K:
+        return "fx0a";
+    case LD_DT_VX:
+        return "fx15";
+    case LD_ST_VX:
+        return "fx18";
+    case ADD_I_VX:
+        return "fx1e";
+    case LD_F_VX:
+        return "fx29";
+    case LD_B_VX:
+        return "fx33";
+    case LD_I_VX:
+        return "fx55";
+    case LD_VX_I:
+        return "fx65";
+    }
+    return "unknown";
+}
+
+std::string format_table(OpStats const& stats)
+{
+    const auto total_count = stats.total_count();
+    const auto total_time  = stats.total_time();
+
+    std::string table = std::format("{:<10} {:>14} {:>7} {:>12} {:>7} {:>9}\n",
+                                    "Opcode", "Count", "Count%", "Time (ms)",
+                                    "Time%", "ns/instr");
+
+    const auto append = [&](std::string_view name,
+                            OpStats::Entry const& entry) {
+        const std::chrono::duration<double, std::milli> ms = entry.time;
+        std::format_to(
+            std::back_inserter(table),
+            "{:<10} {:>14} {:>6.2f}% {:>12.3f} {:>6.2f}% {:>9.1f}\n", name,
+            entry.count, percent(entry.count, total_count), ms.count(),
+            percent(static_cast<uint64_t>(entry.time.count()),
+                    static_cast<uint64_t>(total_time.count())),
+            ns_per_op(entry));
+    };
+
+    for (auto const& row : sorted_rows(stats))
+    {
+        append(to_string(row.op), row.entry);
+    }
+    append("total", {.count = total_count, .time = total_time});
+
+    return table;
+}
+
+std::string format_json(OpStats const& stats)
+{
+    std::string json =
+        std::format("{{\n  \"instructions\": {},\n  \"time_ns\": {},\n"
+                    "  \"clock_overhead_ns\": {:.1f},\n  \"ops\": [",
+                    stats.total_count(), stats.total_time().count(),
+                    stats.clock_overhead.count());
+
+    const char* separator = "\n";
+    for (auto const& row : sorted_rows(stats))
+    {
+        std::format_to(std::back_inserter(json),
+                       "{}    {{\"opcode\": \"{}\", \"count\": {}, "
+                       "\"time_ns\": {}}}",
+                       separator, to_string(row.op), row.entry.count,
+                       row.entry.time.count());
+        separator = ",\n";
+    }
+    json += "\n  ]\n}\n";
+
+    return json;
+}
+
+} // namespace chip8
@@ -0,0 +1,65 @@
+#ifndef CHIP_8_OP_STATS
+#define CHIP_8_OP_STATS
+
+#include "decoder.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace chip8
+{
+
+// Executions of the instructions of every Op and wall time spent executing
+// them, filled by the Cpu while profiling. Most instructions take less time
+// than reading the clock, so the times are only good to compare the Ops with
+// each other, after subtracting the overhead of the clock measured when the
+// stats are created.
+struct OpStats
+{
+    struct Entry
+    {
+        uint64_t count{};
+        std::chrono::nanoseconds time{};
+    };
+
+    OpStats();
+
+    void record(Op op, std::chrono::nanoseconds time) noexcept;
+
+    // Time of the entry without the overhead of the clock.
+    [[nodiscard]] std::chrono::nanoseconds net_time(
+        Entry const& entry) const noexcept;
+
+    [[nodiscard]] uint64_t total_count() const noexcept;
+    [[nodiscard]] std::chrono::nanoseconds total_time() const noexcept;
+
+    std::array<Entry, n_ops> ops{};
+
+    // Time measured around an empty statement.
+    std::chrono::duration<double, std::nano> clock_overhead{};
+};
+
+inline void OpStats::record(Op op, std::chrono::nanoseconds time) noexcept
+{
+    auto& entry = ops[static_cast<std::size_t>(op)];
+    ++entry.count;
+    entry.time += time;
+}
+
+// Opcode pattern of the instructions decoded to op, e.g. "8xy4".
+std::string_view to_string(Op op) noexcept;
+
+// One line per executed Op, from the one that took the most time, with its
+// share of the executions and of the time.
+std::string format_table(OpStats const& stats);
+
+// The same content as format_table as a JSON object.
+std::string format_json(OpStats const& stats);
+
+} // namespace chip8
+
+#endif // CHIP_8_OP_STATS
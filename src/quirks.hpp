@@ -0,0 +1,99 @@
+#ifndef CHIP_8_QUIRKS
+#define CHIP_8_QUIRKS
+
+#include "framebuffer.hpp"
+
+#include <cstdint>
+#include <utility>
+
+namespace chip8
+{
+
+// The interpreters a ROM may have been written for, which disagree on a few
+// instructions. Every profile is a policy of the quirks namespace.
+enum class Profile : uint8_t
+{
+    // What this emulator has always done: the shifts ignore VY, Bnnn adds V0,
+    // Fx55 and Fx65 leave I unchanged and the sprites are clipped.
+    DEFAULT,
+    // The original interpreter of the COSMAC VIP.
+    COSMAC_VIP,
+    // SUPER-CHIP 1.1 on the HP 48, in its low resolution mode.
+    SUPER_CHIP,
+    // XO-CHIP, as implemented by Octo.
+    XO_CHIP
+};
+
+// Policies the Cpu is instantiated with, one per Profile. Every quirk is a
+// compile time constant, so that each profile gets its own handlers without
+// any test on the quirks while running.
+namespace quirks
+{
+
+struct Default
+{
+    // 8xy6 and 8xyE shift VY into VX instead of shifting VX in place.
+    static constexpr bool shift_vy = false;
+    // Bnnn jumps to nnn plus Vx, x being the highest nibble of nnn, instead
+    // of nnn plus V0.
+    static constexpr bool jump_vx = false;
+    // Fx55 and Fx65 leave I past the last register accessed, wrapping around
+    // the end of memory.
+    static constexpr bool load_store_increments_i = false;
+    // 8xy1, 8xy2 and 8xy3 reset VF.
+    static constexpr bool logic_resets_vf = false;
+    static constexpr SpriteEdge sprite_edge = SpriteEdge::CLIP;
+};
+
+struct CosmacVip
+{
+    static constexpr bool shift_vy                = true;
+    static constexpr bool jump_vx                 = false;
+    static constexpr bool load_store_increments_i = true;
+    static constexpr bool logic_resets_vf         = true;
+    static constexpr SpriteEdge sprite_edge       = SpriteEdge::WRAP_ORIGIN;
+};
+
+struct SuperChip
+{
+    static constexpr bool shift_vy                = false;
+    static constexpr bool jump_vx                 = true;
+    static constexpr bool load_store_increments_i = false;
+    static constexpr bool logic_resets_vf         = false;
+    static constexpr SpriteEdge sprite_edge       = SpriteEdge::WRAP_ORIGIN;
+};
+
+struct XoChip
+{
+    static constexpr bool shift_vy                = true;
+    static constexpr bool jump_vx                 = false;
+    static constexpr bool load_store_increments_i = true;
+    static constexpr bool logic_resets_vf         = false;
+    static constexpr SpriteEdge sprite_edge       = SpriteEdge::WRAP;
+};
+
+} // namespace quirks
+
+// Calls f with a value of the policy of the profile, e.g. quirks::XoChip{},
+// so that the code instantiated for every policy is selected once rather
+// than testing the quirks in every instruction.
+template <typename F>
+decltype(auto) visit(Profile profile, F&& f)
+{
+    switch (profile)
+    {
+    case Profile::COSMAC_VIP:
+        return std::forward<F>(f)(quirks::CosmacVip{});
+    case Profile::SUPER_CHIP:
+        return std::forward<F>(f)(quirks::SuperChip{});
+    case Profile::XO_CHIP:
+        return std::forward<F>(f)(quirks::XoChip{});
+    case Profile::DEFAULT:
+        break;
+    }
+    return std::forward<F>(f)(quirks::Default{});
+}
+
+} // namespace chip8
+
+#endif // CHIP_8_QUIRKS
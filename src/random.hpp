@@ -0,0 +1,75 @@
+#ifndef CHIP_8_RANDOM
+#define CHIP_8_RANDOM
+
+#include <bit>
+#include <cstdint>
+
+namespace chip8
+{
+
+// PCG32, the XSH RR variant of the permuted congruential generators: a 64-bit
+// linear congruential state, one multiply and one add per number, whose high
+// bits are permuted into the output. It is eight bytes and holds no pointer,
+// so every machine keeps its own in its state: the numbers drawn by Cxkk
+// depend only on the seed, forks and save states carry the generator along
+// and machines on different threads share nothing.
+class Random
+{
+  public:
+    // Seeded with 0.
+    constexpr Random() noexcept;
+    constexpr explicit Random(uint64_t seed) noexcept;
+
+    // Restarts the sequence from the given seed, as pcg32_srandom() does.
+    constexpr void seed(uint64_t seed) noexcept;
+
+    constexpr uint32_t next() noexcept;
+
+    // The highest bits of next(), which are the most random ones.
+    constexpr uint8_t next_byte() noexcept;
+
+  private:
+    static constexpr uint64_t multiplier = 6364136223846793005ULL;
+    // Any odd number selects a sequence, this is the one of the reference
+    // implementation.
+    static constexpr uint64_t increment = 1442695040888963407ULL;
+
+    uint64_t state_{};
+};
+
+constexpr Random::Random() noexcept
+    : Random(0)
+{
+}
+
+constexpr Random::Random(uint64_t seed) noexcept
+{
+    this->seed(seed);
+}
+
+constexpr void Random::seed(uint64_t seed) noexcept
+{
+    state_ = 0;
+    next();
+    state_ += seed;
+    next();
+}
+
+constexpr uint32_t Random::next() noexcept
+{
+    const uint64_t old = state_;
+    state_             = old * multiplier + increment;
+
+    const auto xorshifted = static_cast<uint32_t>(((old >> 18U) ^ old) >> 27U);
+    const auto rotation   = static_cast<int>(old >> 59U);
+    return std::rotr(xorshifted, rotation);
+}
+
+constexpr uint8_t Random::next_byte() noexcept
+{
+    return static_cast<uint8_t>(next() >> 24U);
+}
+
+} // namespace chip8
+
+#endif // CHIP_8_RANDOM
@@ -0,0 +1,226 @@
+#include "recording.hpp"
+
+#include "constants.hpp"
+#include "save_state.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <expected>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace chip8
+{
+
+namespace
+{
+
+template <typename T>
+bool read(std::ifstream& file, T& value)
+{
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    file.read(reinterpret_cast<char*>(&value), sizeof(value));
+    return static_cast<bool>(file);
+}
+
+} // namespace
+
+std::string_view to_string(RecordingError error) noexcept
+{
+    switch (error)
+    {
+        using enum RecordingError;
+    case FILE_NOT_FOUND:
+        return "recording not found";
+    case WRITE_FAILED:
+        return "cannot write the recording";
+    case INVALID_FORMAT:
+        return "not a valid recording";
+    case UNSUPPORTED_VERSION:
+        return "unsupported recording version";
+    }
+    return "unknown error";
+}
+
+Recorder::Recorder(std::string const& path, RecordingHeader const& header)
+    : file_{path, std::ios::binary | std::ios::trunc},
+      header_{header}
+{
+    write(header_);
+}
+
+bool Recorder::needs_keyframe(uint64_t frame) const noexcept
+{
+    return frame % header_.keyframe_interval == 0;
+}
+
+void Recorder::record_keys(uint64_t instruction, KeyMask keys)
+{
+    if (keys == keys_)
+    {
+        return;
+    }
+    keys_ = keys;
+    ++key_events_;
+    write_event(RecordedEventType::KEYS, instruction, keys);
+}
+
+void Recorder::record_keyframe(uint64_t frame, uint64_t instruction,
+                               SaveState const& state)
+{
+    write_event(RecordedEventType::KEYFRAME, instruction, 0);
+    write(RecordedKeyframe{.frame         = frame,
+                           .instruction   = instruction,
+                           .key_events    = key_events_,
+                           .keys          = keys_,
+                           .reserved_keys = 0,
+                           .reserved      = 0,
+                           .state         = state});
+}
+
+void Recorder::finish(RecordingEnd const& end)
+{
+    write_event(RecordedEventType::END, end.instruction, 0);
+    write(end);
+    file_.flush();
+}
+
+void Recorder::write_event(RecordedEventType type, uint64_t instruction,
+                           KeyMask keys)
+{
+    write(RecordedEvent{.type          = type,
+                        .reserved      = 0,
+                        .keys          = keys,
+                        .reserved_keys = 0,
+                        .instruction   = instruction});
+}
+
+template <typename T>
+void Recorder::write(T const& value)
+{
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    file_.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+std::expected<Recording, RecordingError> read_recording(
+    std::string const& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        return std::unexpected(RecordingError::FILE_NOT_FOUND);
+    }
+
+    Recording recording;
+    if (!read(file, recording.header) ||
+        recording.header.magic != RecordingHeader::expected_magic)
+    {
+        return std::unexpected(RecordingError::INVALID_FORMAT);
+    }
+    if (recording.header.version != RecordingHeader::current_version)
+    {
+        return std::unexpected(RecordingError::UNSUPPORTED_VERSION);
+    }
+    if (recording.header.keyframe_interval == 0 ||
+        recording.header.profile > Profile::XO_CHIP)
+    {
+        return std::unexpected(RecordingError::INVALID_FORMAT);
+    }
+
+    // A recording interrupted without END is still valid up to its last
+    // complete event.
+    RecordedEvent event;
+    while (!recording.end && read(file, event))
+    {
+        switch (event.type)
+        {
+        case RecordedEventType::KEYS:
+            recording.key_events.push_back(
+                KeyEvent{.instruction = event.instruction, .keys = event.keys});
+            break;
+        case RecordedEventType::KEYFRAME:
+        {
+            RecordedKeyframe keyframe;
+            const auto expected_frame = recording.keyframes.size() *
+                                        recording.header.keyframe_interval;
+            if (!read(file, keyframe))
+            {
+                break;
+            }
+            if (keyframe.frame != expected_frame || !validate(keyframe.state))
+            {
+                return std::unexpected(RecordingError::INVALID_FORMAT);
+            }
+            recording.keyframes.push_back(keyframe);
+            break;
+        }
+        case RecordedEventType::END:
+        {
+            RecordingEnd end;
+            if (read(file, end))
+            {
+                recording.end = end;
+            }
+            break;
+        }
+        default:
+            return std::unexpected(RecordingError::INVALID_FORMAT);
+        }
+    }
+
+    // Without the first keyframe there is no state to start from.
+    if (recording.keyframes.empty())
+    {
+        return std::unexpected(RecordingError::INVALID_FORMAT);
+    }
+
+    return recording;
+}
+
+Replay::Replay(Recording recording) : recording_{std::move(recording)}
+{
+}
+
+RecordedKeyframe const& Replay::seek(uint64_t frame) noexcept
+{
+    const auto index =
+        std::min<uint64_t>(frame / recording_.header.keyframe_interval,
+                           recording_.keyframes.size() - 1);
+    const auto& keyframe = recording_.keyframes[index];
+
+    next_event_ = keyframe.key_events;
+    keys_       = keyframe.keys;
+    return keyframe;
+}
+
+KeyMask Replay::keys_at(uint64_t instruction) noexcept
+{
+    const auto& events = recording_.key_events;
+    while (next_event_ < events.size() &&
+           events[next_event_].instruction <= instruction)
+    {
+        keys_ = events[next_event_].keys;
+        ++next_event_;
+    }
+    return keys_;
+}
+
+uint64_t Replay::length() const noexcept
+{
+    if (recording_.end)
+    {
+        return recording_.end->instruction;
+    }
+
+    uint64_t last = recording_.keyframes.back().instruction;
+    if (!recording_.key_events.empty())
+    {
+        last = std::max(last, recording_.key_events.back().instruction);
+    }
+    return last;
+}
+
+} // namespace chip8
@@ -0,0 +1,211 @@
+#ifndef CHIP_8_RECORDING
+#define CHIP_8_RECORDING
+
+#include "constants.hpp"
+#include "keypad.hpp"
+#include "quirks.hpp"
+#include "save_state.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace chip8
+{
+
+// A recording makes a run reproducible. It stores the profile of the machine,
+// the state of the keypad every time it changes, stamped with the number of
+// instructions executed so far, and a keyframe every keyframe_interval
+// frames, so that a replay can start from any frame by restoring a single
+// keyframe. The random generator is part of the machine, and thus of the
+// keyframes.
+//
+// File layout, with the same conventions of SaveState:
+//   RecordingHeader
+//   RecordedEvent, followed by RecordedKeyframe for KEYFRAME events and by
+//   RecordingEnd for the END event, repeated until the END event.
+
+enum class RecordingError : uint8_t
+{
+    FILE_NOT_FOUND,
+    WRITE_FAILED,
+    INVALID_FORMAT,
+    UNSUPPORTED_VERSION
+};
+
+std::string_view to_string(RecordingError error) noexcept;
+
+struct RecordingHeader
+{
+    static constexpr std::array<char, 4> expected_magic{'C', '8', 'R', 'C'};
+    static constexpr uint16_t current_version = 3;
+
+    std::array<char, 4> magic{expected_magic};
+    uint16_t version{current_version};
+    uint16_t keyframe_interval{};
+    // Instructions per second, it sets how many instructions run per frame.
+    uint32_t rate{};
+    // The instructions behave differently in every profile.
+    Profile profile{};
+    std::array<uint8_t, 3> reserved{};
+};
+
+enum class RecordedEventType : uint8_t
+{
+    KEYS,
+    KEYFRAME,
+    END
+};
+
+struct RecordedEvent
+{
+    RecordedEventType type{};
+    uint8_t reserved{};
+    // Keys pressed from this event on, only for KEYS events.
+    KeyMask keys{};
+    uint32_t reserved_keys{};
+    uint64_t instruction{};
+};
+
+struct RecordedKeyframe
+{
+    uint64_t frame{};
+    uint64_t instruction{};
+    // Number of KEYS events recorded before the keyframe.
+    uint64_t key_events{};
+    KeyMask keys{};
+    uint16_t reserved_keys{};
+    uint32_t reserved{};
+    SaveState state{};
+};
+
+struct RecordingEnd
+{
+    uint64_t frame{};
+    uint64_t instruction{};
+    uint64_t framebuffer_hash{};
+    uint64_t state_hash{};
+};
+
+enum class ReplayResult : uint8_t
+{
+    // The replay reached the same final state of the recording.
+    MATCH,
+    MISMATCH,
+    // The recording was interrupted, there is no final state to compare.
+    UNVERIFIED
+};
+
+static_assert(std::has_unique_object_representations_v<RecordingHeader>);
+static_assert(std::has_unique_object_representations_v<RecordedEvent>);
+static_assert(std::has_unique_object_representations_v<RecordedKeyframe>);
+static_assert(std::has_unique_object_representations_v<RecordingEnd>);
+
+// Writes a recording while the emulator runs.
+class Recorder
+{
+  public:
+    // The file is created as soon as the recorder is constructed, check
+    // good() before using it.
+    Recorder(std::string const& path, RecordingHeader const& header);
+
+    [[nodiscard]] bool good() const noexcept;
+
+    [[nodiscard]] RecordingHeader const& get_header() const noexcept;
+
+    // Whether a keyframe must be written before running the given frame.
+    [[nodiscard]] bool needs_keyframe(uint64_t frame) const noexcept;
+
+    // Records the keypad state used from the given instruction on, nothing
+    // is written if it did not change.
+    void record_keys(uint64_t instruction, KeyMask keys);
+
+    void record_keyframe(uint64_t frame, uint64_t instruction,
+                         SaveState const& state);
+
+    void finish(RecordingEnd const& end);
+
+  private:
+    void write_event(RecordedEventType type, uint64_t instruction,
+                     KeyMask keys);
+
+    template <typename T>
+    void write(T const& value);
+
+    std::ofstream file_;
+    RecordingHeader header_;
+
+    KeyMask keys_{};
+    uint64_t key_events_{0};
+};
+
+struct KeyEvent
+{
+    uint64_t instruction{};
+    KeyMask keys{};
+};
+
+struct Recording
+{
+    RecordingHeader header;
+    std::vector<KeyEvent> key_events;
+    // Keyframe i is the one of frame i * keyframe_interval.
+    std::vector<RecordedKeyframe> keyframes;
+    // Missing if the recording was interrupted.
+    std::optional<RecordingEnd> end;
+};
+
+std::expected<Recording, RecordingError> read_recording(
+    std::string const& path);
+
+// Feeds the keys of a recording to the emulator.
+class Replay
+{
+  public:
+    explicit Replay(Recording recording);
+
+    [[nodiscard]] Recording const& get_recording() const noexcept;
+
+    // Keyframe to restore to continue the replay from the given frame, i.e.
+    // the last one at or before it. The keys are rewound to the keyframe.
+    RecordedKeyframe const& seek(uint64_t frame) noexcept;
+
+    // Keys pressed when the given instruction is executed, the instructions
+    // must be non decreasing between seeks.
+    [[nodiscard]] KeyMask keys_at(uint64_t instruction) noexcept;
+
+    // Number of instructions in the replay.
+    [[nodiscard]] uint64_t length() const noexcept;
+
+  private:
+    Recording recording_;
+
+    std::size_t next_event_{0};
+    KeyMask keys_{};
+};
+
+inline bool Recorder::good() const noexcept
+{
+    return file_.good();
+}
+
+inline RecordingHeader const& Recorder::get_header() const noexcept
+{
+    return header_;
+}
+
+inline Recording const& Replay::get_recording() const noexcept
+{
+    return recording_;
+}
+
+} // namespace chip8
+
+#endif // CHIP_8_RECORDING
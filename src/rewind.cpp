@@ -0,0 +1,183 @@
+#include "rewind.hpp"
+
+#include "constants.hpp"
+#include "framebuffer.hpp"
+#include "save_state.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+namespace chip8
+{
+
+RewindBuffer::RewindBuffer(Config config)
+    : config_{config},
+      frames_(std::max<uint32_t>(1, config.frames)),
+      journal_(std::max<uint32_t>(1, config.journal_size))
+{
+    config_.keyframe_interval = std::max<uint32_t>(1, config.keyframe_interval);
+    // One more slot than needed, so that the keyframe of the oldest frame is
+    // not overwritten before the frame itself is dropped.
+    keyframes_.resize(frames_.size() / config_.keyframe_interval + 2);
+    clear();
+}
+
+void RewindBuffer::clear() noexcept
+{
+    first_frame_  = next_frame_;
+    journal_tail_ = journal_head_;
+}
+
+bool RewindBuffer::needs_keyframe() const noexcept
+{
+    return next_frame_ % config_.keyframe_interval == 0;
+}
+
+void RewindBuffer::begin_frame(CpuState const& cpu) noexcept
+{
+    if (size() == frames_.size())
+    {
+        drop_oldest_frame();
+    }
+    frames_[next_frame_ % frames_.size()] =
+        FrameRecord{.cpu = cpu, .journal_begin = journal_head_};
+    ++next_frame_;
+}
+
+void RewindBuffer::begin_frame(SaveState const& keyframe) noexcept
+{
+    assert(needs_keyframe());
+
+    auto& slot =
+        keyframes_[next_frame_ / config_.keyframe_interval % keyframes_.size()];
+    slot.frame = next_frame_;
+    slot.state = keyframe;
+    begin_frame(keyframe.cpu);
+}
+
+void RewindBuffer::record_memory(std::array<uint8_t, memory::size> const& mem,
+                                 uint16_t address, std::size_t size) noexcept
+{
+    const auto end = std::min<std::size_t>(address + size, memory::size);
+    for (std::size_t i = address; i < end; ++i)
+    {
+        record(static_cast<uint16_t>(i), mem[i]);
+    }
+}
+
+void RewindBuffer::record_rows(Framebuffer const& framebuffer,
+                               std::size_t first, std::size_t count) noexcept
+{
+    const auto end = std::min<std::size_t>(first + count, display::height_size);
+    for (std::size_t y = first; y < end; ++y)
+    {
+        record(static_cast<uint16_t>(memory::size + y), framebuffer.rows[y]);
+    }
+}
+
+std::size_t RewindBuffer::rewind(std::size_t n, SaveState& state) noexcept
+{
+    n = std::min(n, size());
+    if (n == 0)
+    {
+        return 0;
+    }
+
+    const uint64_t target = next_frame_ - n;
+
+    // Undo from the closest keyframe after the target, if it is closer than
+    // the current state.
+    uint64_t frame = next_frame_;
+    if (const auto* keyframe = find_keyframe(target);
+        keyframe && keyframe->frame - target < n)
+    {
+        state = keyframe->state;
+        frame = keyframe->frame;
+    }
+    while (frame > target)
+    {
+        undo_frame(--frame, state);
+    }
+
+    journal_head_ = frames_[target % frames_.size()].journal_begin;
+    next_frame_   = target;
+
+    return n;
+}
+
+void RewindBuffer::record(uint16_t location, uint64_t value) noexcept
+{
+    // No frame is being recorded, e.g. its writes did not fit in the journal.
+    if (size() == 0)
+    {
+        return;
+    }
+
+    while (journal_head_ - journal_tail_ == journal_.size())
+    {
+        if (size() == 1)
+        {
+            // The current frame alone does not fit, it cannot be rewound.
+            clear();
+            return;
+        }
+        drop_oldest_frame();
+    }
+
+    journal_[journal_head_ % journal_.size()] =
+        JournalEntry{.value = value, .location = location};
+    ++journal_head_;
+}
+
+void RewindBuffer::drop_oldest_frame() noexcept
+{
+    assert(size() != 0);
+
+    ++first_frame_;
+    journal_tail_ = first_frame_ == next_frame_
+                        ? journal_head_
+                        : frames_[first_frame_ % frames_.size()].journal_begin;
+}
+
+void RewindBuffer::undo_frame(uint64_t frame, SaveState& state) const noexcept
+{
+    const auto& record = frames_[frame % frames_.size()];
+    const auto& next   = frames_[(frame + 1) % frames_.size()];
+
+    const auto begin = record.journal_begin;
+    const auto end =
+        frame + 1 == next_frame_ ? journal_head_ : next.journal_begin;
+
+    for (auto i = end; i > begin; --i)
+    {
+        const auto& entry = journal_[(i - 1) % journal_.size()];
+        if (entry.location < memory::size)
+        {
+            state.memory[entry.location] = static_cast<uint8_t>(entry.value);
+        }
+        else
+        {
+            state.framebuffer.rows[entry.location - memory::size] = entry.value;
+        }
+    }
+
+    state.cpu = record.cpu;
+}
+
+const RewindBuffer::Keyframe* RewindBuffer::find_keyframe(
+    uint64_t frame) const noexcept
+{
+    const uint64_t interval = config_.keyframe_interval;
+    const uint64_t keyframe = (frame + interval - 1) / interval * interval;
+    if (keyframe >= next_frame_)
+    {
+        return nullptr;
+    }
+
+    const auto& slot = keyframes_[keyframe / interval % keyframes_.size()];
+    return slot.frame == keyframe ? &slot : nullptr;
+}
+
+} // namespace chip8
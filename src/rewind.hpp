@@ -0,0 +1,125 @@
+#ifndef CHIP_8_REWIND
+#define CHIP_8_REWIND
+
+#include "constants.hpp"
+#include "framebuffer.hpp"
+#include "save_state.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace chip8
+{
+
+struct RewindConfig
+{
+    // Frames of history that can be rewound.
+    uint32_t frames{rewind::default_seconds * timer::fps};
+    // A full snapshot of the machine is kept every keyframe_interval frames.
+    uint32_t keyframe_interval{rewind::keyframe_interval};
+    // Memory bytes and framebuffer rows that can be journaled over all the
+    // frames. When exhausted the oldest frames are dropped.
+    uint32_t journal_size{rewind::default_seconds * timer::fps *
+                          rewind::journal_entries_per_frame};
+};
+
+// History of the machine state, frame by frame.
+//
+// At the start of every frame the Cpu registers are saved, then every write
+// to memory and to the framebuffer done during the frame is journaled with the
+// value it overwrites. Undoing a frame means restoring the journaled values in
+// reverse order, so its cost depends only on the writes done in the frame.
+// Every keyframe_interval frames a full SaveState is kept as well, so that
+// going back many frames at once costs at most keyframe_interval undos.
+//
+// All the storage is allocated at construction time and used as ring
+// buffers, the memory used is therefore bounded by the configuration.
+class RewindBuffer
+{
+  public:
+    using Config = RewindConfig;
+
+    explicit RewindBuffer(Config config);
+
+    [[nodiscard]] Config get_config() const noexcept;
+
+    // Number of frames that can be rewound.
+    [[nodiscard]] std::size_t size() const noexcept;
+
+    void clear() noexcept;
+
+    // Whether the frame about to start must be recorded with a keyframe.
+    [[nodiscard]] bool needs_keyframe() const noexcept;
+
+    // Start recording a new frame given the state of the machine at its
+    // start, the keyframe overload must be used when needs_keyframe().
+    void begin_frame(CpuState const& cpu) noexcept;
+    void begin_frame(SaveState const& keyframe) noexcept;
+
+    // Journal the values about to be overwritten in the current frame.
+    void record_memory(std::array<uint8_t, memory::size> const& mem,
+                       uint16_t address, std::size_t size) noexcept;
+    void record_rows(Framebuffer const& framebuffer, std::size_t first,
+                     std::size_t count) noexcept;
+
+    // Brings state, which must be the current state of the machine, back to
+    // the start of the n-th last recorded frame and drops the frames after
+    // it. Returns the number of frames actually rewound.
+    std::size_t rewind(std::size_t n, SaveState& state) noexcept;
+
+  private:
+    struct JournalEntry
+    {
+        uint64_t value;
+        // Memory address, or memory::size plus the row for framebuffer rows.
+        uint16_t location;
+    };
+
+    struct FrameRecord
+    {
+        CpuState cpu;
+        uint64_t journal_begin;
+    };
+
+    struct Keyframe
+    {
+        uint64_t frame;
+        SaveState state;
+    };
+
+    void record(uint16_t location, uint64_t value) noexcept;
+    void drop_oldest_frame() noexcept;
+    void undo_frame(uint64_t frame, SaveState& state) const noexcept;
+
+    [[nodiscard]] const Keyframe* find_keyframe(uint64_t frame) const noexcept;
+
+    Config config_;
+
+    // Frames, journal entries and keyframes are numbered since the creation
+    // of the buffer, the slot of a number is the number modulo the capacity.
+    std::vector<FrameRecord> frames_;
+    uint64_t first_frame_{0};
+    uint64_t next_frame_{0};
+
+    std::vector<JournalEntry> journal_;
+    uint64_t journal_tail_{0};
+    uint64_t journal_head_{0};
+
+    std::vector<Keyframe> keyframes_;
+};
+
+inline RewindBuffer::Config RewindBuffer::get_config() const noexcept
+{
+    return config_;
+}
+
+inline std::size_t RewindBuffer::size() const noexcept
+{
+    return next_frame_ - first_frame_;
+}
+
+} // namespace chip8
+
+#endif // CHIP_8_REWIND
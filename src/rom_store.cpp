@@ -0,0 +1,208 @@
+#include "rom_store.hpp"
+
+#include "constants.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <mutex>
+#include <span>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace chip8
+{
+
+namespace
+{
+
+// 64-bit FNV-1a hash of the ROM content.
+uint64_t hash(std::span<const uint8_t> rom) noexcept
+{
+    constexpr uint64_t offset_basis = 0xcbf29ce484222325;
+    constexpr uint64_t prime        = 0x100000001b3;
+
+    uint64_t h = offset_basis;
+    for (const auto byte : rom)
+    {
+        h ^= byte;
+        h *= prime;
+    }
+    return h;
+}
+
+std::span<const uint8_t> bytes(
+    std::variant<MappedRom, std::vector<uint8_t>> const& image) noexcept
+{
+    if (const auto* mapping = std::get_if<MappedRom>(&image))
+    {
+        return mapping->data();
+    }
+    return std::get<std::vector<uint8_t>>(image);
+}
+
+} // namespace
+
+std::expected<void, LoadRomError> validate_rom(
+    std::span<const uint8_t> rom) noexcept
+{
+    if (rom.empty())
+    {
+        return std::unexpected(LoadRomError::ROM_EMPTY);
+    }
+    if (rom.size() > memory::rom_max_size)
+    {
+        return std::unexpected(LoadRomError::ROM_TOO_BIG);
+    }
+    return {};
+}
+
+MappedRom::MappedRom(const uint8_t* data, std::size_t size) noexcept
+    : data_{data}, size_{size}
+{
+}
+
+MappedRom::MappedRom(MappedRom&& other) noexcept
+    : data_{std::exchange(other.data_, nullptr)},
+      size_{std::exchange(other.size_, 0)}
+{
+}
+
+MappedRom::~MappedRom()
+{
+    if (data_ != nullptr)
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+        munmap(const_cast<uint8_t*>(data_), size_);
+    }
+}
+
+MappedRom& MappedRom::operator=(MappedRom&& other) noexcept
+{
+    if (this != &other)
+    {
+        MappedRom old(std::move(*this));
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+}
+
+std::expected<MappedRom, LoadRomError> map_rom(std::string const& path)
+{
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg)
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return std::unexpected(LoadRomError::FILE_NOT_FOUND);
+    }
+
+    struct stat info{};
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode))
+    {
+        close(fd);
+        return std::unexpected(LoadRomError::FILE_NOT_FOUND);
+    }
+    if (info.st_size == 0)
+    {
+        close(fd);
+        return std::unexpected(LoadRomError::ROM_EMPTY);
+    }
+    if (info.st_size > memory::rom_max_size)
+    {
+        close(fd);
+        return std::unexpected(LoadRomError::ROM_TOO_BIG);
+    }
+
+    const auto size = static_cast<std::size_t>(info.st_size);
+    void* data      = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file.
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return std::unexpected(LoadRomError::FILE_NOT_FOUND);
+    }
+
+    return MappedRom(static_cast<const uint8_t*>(data), size);
+}
+
+std::expected<std::vector<uint8_t>, LoadRomError> read_rom(
+    std::string const& path)
+{
+    const auto mapping = map_rom(path);
+    if (!mapping)
+    {
+        return std::unexpected(mapping.error());
+    }
+    const auto rom = mapping->data();
+    return std::vector<uint8_t>(rom.begin(), rom.end());
+}
+
+std::expected<std::span<const uint8_t>, LoadRomError> RomStore::open(
+    std::string const& path)
+{
+    {
+        std::scoped_lock lock(mutex_);
+        if (const auto it = paths_.find(path); it != paths_.end())
+        {
+            return it->second;
+        }
+    }
+
+    // Mapped without holding the lock, if another thread maps the same file
+    // in the meantime intern() keeps only one of the two.
+    auto mapping = map_rom(path);
+    if (!mapping)
+    {
+        return std::unexpected(mapping.error());
+    }
+
+    const auto rom = intern(std::move(*mapping));
+
+    std::scoped_lock lock(mutex_);
+    paths_.try_emplace(path, rom);
+    return rom;
+}
+
+std::expected<std::span<const uint8_t>, LoadRomError> RomStore::add(
+    std::span<const uint8_t> rom)
+{
+    if (auto res = validate_rom(rom); !res)
+    {
+        return std::unexpected(res.error());
+    }
+    return intern(std::vector<uint8_t>(rom.begin(), rom.end()));
+}
+
+std::size_t RomStore::size() const
+{
+    std::scoped_lock lock(mutex_);
+    return images_.size();
+}
+
+std::span<const uint8_t> RomStore::intern(Image image)
+{
+    const auto rom = bytes(image);
+    const auto key = hash(rom);
+
+    std::scoped_lock lock(mutex_);
+    const auto [first, last] = images_.equal_range(key);
+    for (auto it = first; it != last; ++it)
+    {
+        if (const auto held = bytes(it->second); std::ranges::equal(held, rom))
+        {
+            return held;
+        }
+    }
+    return bytes(images_.emplace(key, std::move(image))->second);
+}
+
+} // namespace chip8
@@ -0,0 +1,106 @@
+#ifndef CHIP_8_ROM_STORE
+#define CHIP_8_ROM_STORE
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace chip8
+{
+
+enum class LoadRomError : uint8_t
+{
+    FILE_NOT_FOUND,
+    ROM_EMPTY,
+    ROM_TOO_BIG
+};
+
+// Checks that the ROM fits in the memory.
+std::expected<void, LoadRomError> validate_rom(
+    std::span<const uint8_t> rom) noexcept;
+
+// Read-only memory mapping of a ROM file, unmapped on destruction.
+class MappedRom
+{
+  public:
+    MappedRom() noexcept = default;
+    MappedRom(MappedRom const&) = delete;
+    MappedRom(MappedRom&& other) noexcept;
+
+    ~MappedRom();
+
+    MappedRom& operator=(MappedRom const&) = delete;
+    MappedRom& operator=(MappedRom&& other) noexcept;
+
+    [[nodiscard]] std::span<const uint8_t> data() const noexcept;
+
+  private:
+    friend std::expected<MappedRom, LoadRomError> map_rom(
+        std::string const& path);
+
+    MappedRom(const uint8_t* data, std::size_t size) noexcept;
+
+    const uint8_t* data_{nullptr};
+    std::size_t size_{0};
+};
+
+inline std::span<const uint8_t> MappedRom::data() const noexcept
+{
+    return {data_, size_};
+}
+
+// Maps a ROM file checking that it fits in the memory.
+std::expected<MappedRom, LoadRomError> map_rom(std::string const& path);
+
+// Reads a ROM file checking that it fits in the memory.
+std::expected<std::vector<uint8_t>, LoadRomError> read_rom(
+    std::string const& path);
+
+// Read-only ROMs shared by many Chip8 instances, e.g. by the workers of a
+// BatchRunner. Every file is mapped once, and ROMs with the same content are
+// kept only once whatever their path. The returned bytes stay valid as long
+// as the store. All the members can be called from any thread.
+class RomStore
+{
+  public:
+    RomStore() = default;
+    RomStore(RomStore const&) = delete;
+    RomStore(RomStore&&)      = delete;
+
+    ~RomStore() = default;
+
+    RomStore& operator=(RomStore const&) = delete;
+    RomStore& operator=(RomStore&&)      = delete;
+
+    std::expected<std::span<const uint8_t>, LoadRomError> open(
+        std::string const& path);
+
+    // Copies a ROM that is already in memory, no file is involved.
+    std::expected<std::span<const uint8_t>, LoadRomError> add(
+        std::span<const uint8_t> rom);
+
+    // Number of distinct ROMs held.
+    [[nodiscard]] std::size_t size() const;
+
+  private:
+    using Image = std::variant<MappedRom, std::vector<uint8_t>>;
+
+    // Returns the held ROM with the same content as image, adding image if
+    // there is none.
+    std::span<const uint8_t> intern(Image image);
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, std::span<const uint8_t>> paths_;
+    // By content hash, nodes never move so the spans stay valid.
+    std::unordered_multimap<uint64_t, Image> images_;
+};
+
+} // namespace chip8
+
+#endif // CHIP_8_ROM_STORE
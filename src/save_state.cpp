@@ -0,0 +1,117 @@
+#include "save_state.hpp"
+
+#include "constants.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <fstream>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace chip8
+{
+
+std::string_view to_string(StateError error) noexcept
+{
+    switch (error)
+    {
+        using enum StateError;
+    case FILE_NOT_FOUND:
+        return "state file not found";
+    case WRITE_FAILED:
+        return "cannot write the state file";
+    case INVALID_FORMAT:
+        return "not a save state";
+    case UNSUPPORTED_VERSION:
+        return "unsupported save state version";
+    case INVALID_STATE:
+        return "corrupted save state";
+    }
+    return "unknown error";
+}
+
+uint64_t hash(SaveState const& state) noexcept
+{
+    constexpr uint64_t offset_basis = 0xcbf29ce484222325;
+    constexpr uint64_t prime        = 0x100000001b3;
+
+    const auto bytes = std::as_bytes(std::span(&state, 1));
+
+    uint64_t h = offset_basis;
+    for (const auto byte : bytes)
+    {
+        h ^= static_cast<uint64_t>(byte);
+        h *= prime;
+    }
+    return h;
+}
+
+std::expected<void, StateError> validate(SaveState const& state) noexcept
+{
+    if (state.magic != SaveState::expected_magic)
+    {
+        return std::unexpected(StateError::INVALID_FORMAT);
+    }
+    if (state.version != SaveState::current_version)
+    {
+        return std::unexpected(StateError::UNSUPPORTED_VERSION);
+    }
+
+    // The saved pc is wrapped around the end of memory, as every fetch wraps
+    // it, so that it may be odd or even 0xFFF but never past the end.
+    if (state.cpu.pc >= memory::size)
+    {
+        return std::unexpected(StateError::INVALID_STATE);
+    }
+    // Any index and stack pointer are valid: the instructions wrap the
+    // addresses they access through the index around the end of memory, and
+    // the stack pointer around the stack.
+
+    return {};
+}
+
+std::expected<SaveState, StateError> read_state(std::string const& path)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+        return std::unexpected(StateError::FILE_NOT_FOUND);
+    }
+
+    if (file.tellg() != sizeof(SaveState))
+    {
+        return std::unexpected(StateError::INVALID_FORMAT);
+    }
+
+    SaveState state;
+    file.seekg(0, std::ios::beg);
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    file.read(reinterpret_cast<char*>(&state), sizeof(state));
+    if (!file)
+    {
+        return std::unexpected(StateError::INVALID_FORMAT);
+    }
+
+    if (auto res = validate(state); !res)
+    {
+        return std::unexpected(res.error());
+    }
+    return state;
+}
+
+std::expected<void, StateError> write_state(std::string const& path,
+                                            SaveState const& state)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    file.write(reinterpret_cast<const char*>(&state), sizeof(state));
+    if (!file)
+    {
+        return std::unexpected(StateError::WRITE_FAILED);
+    }
+    return {};
+}
+
+} // namespace chip8
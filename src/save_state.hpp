@@ -0,0 +1,94 @@
+#ifndef CHIP_8_SAVE_STATE
+#define CHIP_8_SAVE_STATE
+
+#include "constants.hpp"
+#include "framebuffer.hpp"
+#include "random.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace chip8
+{
+
+enum class StateError : uint8_t
+{
+    FILE_NOT_FOUND,
+    WRITE_FAILED,
+    // The data is not a save state: wrong size or magic.
+    INVALID_FORMAT,
+    // The data was written by another version of the format or by a host with
+    // a different byte order.
+    UNSUPPORTED_VERSION,
+    // The header is valid but the machine state is not, e.g. pc out of memory.
+    INVALID_STATE
+};
+
+// Human readable description of the error.
+std::string_view to_string(StateError error) noexcept;
+
+// Registers, stack, timers and random generator of the Cpu. The layout has no
+// implicit padding and is part of SaveState, see there.
+struct CpuState
+{
+    std::array<uint16_t, cpu::stack_size> stack{};
+    std::array<uint8_t, cpu::n_registers> registers{};
+    uint16_t index{};
+    uint16_t pc{};
+    int8_t stack_ptr{};
+    uint8_t delay_timer{};
+    uint8_t sound_timer{};
+    uint8_t reserved{};
+    Random random{};
+};
+
+static_assert(std::is_trivially_copyable_v<CpuState>);
+static_assert(std::has_unique_object_representations_v<CpuState>,
+              "CpuState must not contain padding bytes");
+
+// Snapshot of the whole machine. The layout is fixed and has no implicit
+// padding, so a state is saved and restored with a single copy of the struct.
+// Multi-byte fields use the host byte order, the version field doubles as a
+// byte order mark.
+//
+// Any change to the layout must bump version.
+struct SaveState
+{
+    static constexpr std::array<char, 4> expected_magic{'C', '8', 'S', 'T'};
+    static constexpr uint16_t current_version = 2;
+
+    std::array<char, 4> magic{expected_magic};
+    uint16_t version{current_version};
+    uint16_t reserved_header{};
+
+    Framebuffer framebuffer{};
+    std::array<uint8_t, memory::size> memory{};
+
+    CpuState cpu{};
+};
+
+static_assert(std::is_trivially_copyable_v<SaveState>);
+static_assert(std::has_unique_object_representations_v<SaveState>,
+              "SaveState must not contain padding bytes");
+static_assert(offsetof(SaveState, framebuffer) == 8);
+static_assert(sizeof(SaveState) == 4424);
+
+// 64-bit FNV-1a hash of the whole state.
+[[nodiscard]] uint64_t hash(SaveState const& state) noexcept;
+
+// Checks that the state can be restored.
+std::expected<void, StateError> validate(SaveState const& state) noexcept;
+
+std::expected<SaveState, StateError> read_state(std::string const& path);
+
+std::expected<void, StateError> write_state(std::string const& path,
+                                            SaveState const& state);
+
+} // namespace chip8
+
+#endif // CHIP_8_SAVE_STATE
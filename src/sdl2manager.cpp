@@ -1,30 +1,39 @@
 #include "sdl2manager.hpp"
 #include "SDL_keycode.h"
+#include "audio_engine.hpp"
 #include "constants.hpp"
+#include "framebuffer.hpp"
+#include "keypad.hpp"
 
 #include <SDL_events.h>
 
 #include <cassert>
-#include <cstring>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
 #include <print>
-#include <vector>
+#include <utility>
 
 namespace
 {
 
-// Defined as a global variable and not as a class member because it must be
-// accessible from inside the callback in the setup_beep function, i.e. a
-// c-style function pointer and therefore the lambda used cannot capture values.
-// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
-SDL_AudioDeviceID g_audio_device;
+// Packs a color in the layout of SDL_PIXELFORMAT_ARGB8888.
+constexpr uint32_t to_argb(chip8::utility::Color const& color) noexcept
+{
+    return static_cast<uint32_t>(color.a) << 24U |
+           static_cast<uint32_t>(color.r) << 16U |
+           static_cast<uint32_t>(color.g) << 8U |
+           static_cast<uint32_t>(color.b);
+}
 
 } // namespace
 
 namespace chip8
 {
 
-Sdl2Manager::Sdl2Manager() noexcept = default;
+Sdl2Manager::Sdl2Manager(Config const& config) noexcept : config_{config}
+{
+}
 
 Sdl2Manager::~Sdl2Manager()
 {
@@ -36,8 +45,12 @@ Sdl2Manager::~Sdl2Manager()
 
 bool Sdl2Manager::start()
 {
-    running_ = init() && create_window() && create_renderer();
-    setup_beep();
+    running_ = init() && create_window() && create_renderer() &&
+               create_texture();
+    if (running_)
+    {
+        setup_audio();
+    }
     return running_;
 }
 
@@ -57,13 +70,26 @@ bool Sdl2Manager::update()
             return false;
         }
 
-        if (event.type == SDL_KEYDOWN)
+        if (event.type == SDL_KEYDOWN && key == SDLK_F5)
+        {
+            pending_command_ = Command::SAVE_STATE;
+        }
+        else if (event.type == SDL_KEYDOWN && key == SDLK_F9)
+        {
+            pending_command_ = Command::LOAD_STATE;
+        }
+        else if (key == SDLK_BACKSPACE &&
+                 (event.type == SDL_KEYDOWN || event.type == SDL_KEYUP))
         {
-            pressed_keys_.insert(key);
+            rewind_held_ = event.type == SDL_KEYDOWN;
+        }
+        else if (event.type == SDL_KEYDOWN)
+        {
+            keys_ |= config_.key_map.bit_of(key);
         }
         else if (event.type == SDL_KEYUP)
         {
-            pressed_keys_.erase(key);
+            keys_ &= static_cast<KeyMask>(~config_.key_map.bit_of(key));
         }
     }
 
@@ -77,6 +103,11 @@ void Sdl2Manager::stop() noexcept
         return;
     }
 
+    if (texture_)
+    {
+        SDL_DestroyTexture(texture_);
+        texture_ = nullptr;
+    }
     if (renderer_)
     {
         SDL_DestroyRenderer(renderer_);
@@ -87,93 +118,64 @@ void Sdl2Manager::stop() noexcept
         SDL_DestroyWindow(window_);
         window_ = nullptr;
     }
-    if (g_audio_device != 0)
+    if (audio_device_ != 0)
     {
-        SDL_CloseAudioDevice(g_audio_device);
-        g_audio_device = 0;
+        SDL_CloseAudioDevice(audio_device_);
+        audio_device_ = 0;
     }
     SDL_Quit();
 }
 
-void Sdl2Manager::fetch_keys(std::array<bool, chip8::input::n_keys>& out_keys,
-                             bool additive)
+Command Sdl2Manager::poll_command() noexcept
 {
-    if (!additive)
-    {
-        std::ranges::fill(out_keys, false);
-    }
-
-    for (const auto key : pressed_keys_)
+    if (pending_command_ != Command::NONE)
     {
-        switch (key)
-        {
-        // NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers,
-        //             readability-magic-numbers)
-        // clang-format off
-            case '1': out_keys[0x1] = true; break;
-            case '2': out_keys[0x2] = true; break;
-            case '3': out_keys[0x3] = true; break;
-            case '4': out_keys[0xc] = true; break;
-            case 'q': out_keys[0x4] = true; break;
-            case 'w': out_keys[0x5] = true; break;
-            case 'e': out_keys[0x6] = true; break;
-            case 'r': out_keys[0xd] = true; break;
-            case 'a': out_keys[0x7] = true; break;
-            case 's': out_keys[0x8] = true; break;
-            case 'd': out_keys[0x9] = true; break;
-            case 'f': out_keys[0xe] = true; break;
-            case 'z': out_keys[0xa] = true; break;
-            case 'x': out_keys[0x0] = true; break;
-            case 'c': out_keys[0xb] = true; break;
-            case 'v': out_keys[0xf] = true; break;
-        // clang-format on
-        // NOLINTEND
-        default:
-        }
+        return std::exchange(pending_command_, Command::NONE);
     }
+    return rewind_held_ ? Command::REWIND : Command::NONE;
 }
 
-void Sdl2Manager::render(
-    utility::matrix<bool, display::height_size, display::width_size> const&
-        pixels) noexcept
+void Sdl2Manager::render(Framebuffer const& framebuffer) noexcept
 {
     assert(running_);
+    assert(texture_);
+
+    void* pixels = nullptr;
+    int pitch    = 0;
+    if (SDL_LockTexture(texture_, nullptr, &pixels, &pitch) != 0)
+    {
+        return;
+    }
 
-    SDL_SetRenderDrawColor(renderer_, config_.background.r,
-                           config_.background.g, config_.background.b,
-                           config_.background.a);
-    SDL_RenderClear(renderer_);
-    SDL_SetRenderDrawColor(renderer_, config_.foreground.r,
-                           config_.foreground.g, config_.foreground.b,
-                           config_.foreground.a);
+    const uint32_t background = to_argb(config_.background);
+    const uint32_t foreground = to_argb(config_.foreground);
 
-    for (int y = 0; y < display::height_size; ++y)
+    // The texture has one texel per CHIP-8 pixel, the scaling to the window
+    // size is left to the renderer in SDL_RenderCopy.
+    auto* bytes = static_cast<uint8_t*>(pixels);
+    for (uint8_t y = 0; y < display::height_size; ++y)
     {
-        for (int x = 0; x < display::width_size; ++x)
+        // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        auto* texels = reinterpret_cast<uint32_t*>(bytes + y * pitch);
+        Framebuffer::Row row = framebuffer.rows[y];
+        for (uint8_t x = 0; x < display::width_size; ++x)
         {
-            if (pixels[y][x])
-            {
-                SDL_Rect pixel_rect;
-                pixel_rect.x = x * display::pixel_scale;
-                pixel_rect.y = y * display::pixel_scale;
-                pixel_rect.w = display::pixel_scale;
-                pixel_rect.h = display::pixel_scale;
-
-                SDL_RenderFillRect(renderer_, &pixel_rect);
-            }
+            texels[x] = (row >> 63U) != 0 ? foreground : background;
+            row <<= 1U;
         }
+        // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
     }
 
+    SDL_UnlockTexture(texture_);
+
+    SDL_RenderCopy(renderer_, texture_, nullptr, nullptr);
     SDL_RenderPresent(renderer_);
 }
 
-// NOLINTNEXTLINE(readability-make-member-function-const)
-void Sdl2Manager::play_beep() noexcept
+void Sdl2Manager::set_sound(bool on) noexcept
 {
-    assert(running_);
-    assert(g_audio_device != 0);
-
-    SDL_PauseAudioDevice(g_audio_device, 0);
+    audio_.set_sound(on);
 }
 
 bool Sdl2Manager::init() noexcept
@@ -221,44 +223,49 @@ bool Sdl2Manager::create_renderer() noexcept
     return true;
 }
 
-// NOLINTNEXTLINE(readability-make-member-function-const)
-void Sdl2Manager::setup_beep() noexcept
+bool Sdl2Manager::create_texture() noexcept
 {
-    assert(running_);
+    assert(renderer_);
 
-    constexpr int sample_rate = 44100;
-    constexpr int samples     = 2048;
-    constexpr float freq      = 440.0f;
-    constexpr float volume    = 0.2f;
-    constexpr float two_pi    = 6.28318531f;
-    SDL_AudioSpec want        = {};
-    want.freq                 = sample_rate;
-    want.format               = AUDIO_F32SYS;
-    want.channels             = 1;
-    want.samples              = samples;
-    want.callback             = [](void*, Uint8* stream, int len) {
-        static float phase = 0.0f;
-        size_t n_samples   = static_cast<size_t>(len) / sizeof(float);
-        std::vector<float> buffer(n_samples);
-        for (size_t i = 0; i < n_samples; ++i)
-        {
-            buffer[i] = volume * sinf(phase);
-            phase += two_pi * freq / sample_rate;
-            if (phase > two_pi)
-            {
-                phase -= two_pi;
-            }
-        }
-        memcpy(stream, buffer.data(), n_samples * sizeof(float));
+    texture_ = SDL_CreateTexture(renderer_, SDL_PIXELFORMAT_ARGB8888,
+                                 SDL_TEXTUREACCESS_STREAMING,
+                                 display::width_size, display::height_size);
+    if (!texture_)
+    {
+        std::print(std::cerr, "SDL_CreateTexture failed: {}", SDL_GetError());
+        stop();
+        return false;
+    }
+    return true;
+}
+
+void Sdl2Manager::setup_audio() noexcept
+{
+    assert(running_);
 
-        SDL_PauseAudioDevice(g_audio_device, 1);
+    SDL_AudioSpec want = {};
+    want.freq          = audio::sample_rate;
+    want.format        = AUDIO_F32SYS;
+    want.channels      = 1;
+    want.samples       = audio::buffer_samples;
+    want.callback      = [](void* userdata, Uint8* stream, int len) {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        auto* samples = reinterpret_cast<float*>(stream);
+        static_cast<AudioEngine*>(userdata)->render(
+            {samples, static_cast<std::size_t>(len) / sizeof(float)});
     };
-    want.userdata = nullptr;
+    want.userdata = &audio_;
 
-    // Setup the audio device and immediately pause them in order to avoid to
-    // reproduce the sound now.
-    g_audio_device = SDL_OpenAudioDevice(nullptr, 0, &want, nullptr, 0);
-    SDL_PauseAudioDevice(g_audio_device, 1);
+    // SDL converts the samples if the device does not support the format. The
+    // device plays all the time, silence while the tone is off.
+    audio_device_ = SDL_OpenAudioDevice(nullptr, 0, &want, nullptr, 0);
+    if (audio_device_ == 0)
+    {
+        std::print(std::cerr, "SDL_OpenAudioDevice failed: {}",
+                   SDL_GetError());
+        return;
+    }
+    SDL_PauseAudioDevice(audio_device_, 0);
 }
 
 } // namespace chip8
@@ -1,12 +1,14 @@
 #ifndef CHIP_8_SDL_2_MANAGER
 #define CHIP_8_SDL_2_MANAGER
 
+#include "audio_engine.hpp"
 #include "constants.hpp"
+#include "framebuffer.hpp"
 #include "io_manager.hpp"
+#include "keypad.hpp"
 #include "utility.hpp"
 
 #include <SDL2/SDL.h>
-#include <unordered_set>
 
 namespace chip8
 {
@@ -15,6 +17,7 @@ struct Sdl2ManagerConfig
 {
     utility::Color background = utility::black;
     utility::Color foreground = utility::white;
+    KeyMap key_map{};
 };
 
 class Sdl2Manager : public IOManager
@@ -22,7 +25,7 @@ class Sdl2Manager : public IOManager
   public:
     using Config = Sdl2ManagerConfig;
 
-    Sdl2Manager() noexcept;
+    explicit Sdl2Manager(Config const& config = {}) noexcept;
     Sdl2Manager(const Sdl2Manager&) = delete;
     Sdl2Manager(Sdl2Manager&&)      = delete;
 
@@ -40,24 +43,32 @@ class Sdl2Manager : public IOManager
     bool update() override;
     void stop() noexcept override;
 
-    void fetch_keys(std::array<bool, chip8::input::n_keys>& out_keys,
-                    bool additive) override;
+    Command poll_command() noexcept override;
 
-    void render(
-        utility::matrix<bool, display::height_size, display::width_size> const&
-            pixels) noexcept override;
+    [[nodiscard]] KeyMask get_keys() const noexcept override;
 
-    void play_beep() noexcept override;
+    void render(Framebuffer const& framebuffer) noexcept override;
+
+    void set_sound(bool on) noexcept override;
 
   private:
     bool init() noexcept;
     bool create_window() noexcept;
     bool create_renderer() noexcept;
-    void setup_beep() noexcept;
+    bool create_texture() noexcept;
+    void setup_audio() noexcept;
 
     SDL_Window* window_{nullptr};
     SDL_Renderer* renderer_{nullptr};
-    std::unordered_set<SDL_Keycode> pressed_keys_;
+    SDL_Texture* texture_{nullptr};
+    SDL_AudioDeviceID audio_device_{0};
+    // Outlives the audio device, the emulation thread may send it events at
+    // any time.
+    AudioEngine audio_;
+    // Only changed by the events seen by update().
+    KeyMask keys_{0};
+    bool rewind_held_{false};
+    Command pending_command_{Command::NONE};
 
     bool running_{false};
 
@@ -79,6 +90,11 @@ inline Sdl2Manager::Config Sdl2Manager::get_config() noexcept
     return running_;
 }
 
+inline KeyMask Sdl2Manager::get_keys() const noexcept
+{
+    return keys_;
+}
+
 } // namespace chip8
 
 #endif // CHIP_8_SDL_2_MANAGER
@@ -0,0 +1,124 @@
+#ifndef CHIP_8_SPSC_RING
+#define CHIP_8_SPSC_RING
+
+#include "constants.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace chip8
+{
+
+// Bounded lock-free queue between exactly one producer thread and one
+// consumer thread. Each side owns one index and only reads the other one when
+// its cached copy says the queue is full, or empty, so that in the common case
+// a push or a pop touches no cache line written by the other thread.
+template <typename T>
+class SpscRing
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+
+  public:
+    // The capacity is rounded up to a power of two.
+    explicit SpscRing(std::size_t capacity);
+
+    // Producer side. Returns false, without blocking, if the queue is full.
+    bool try_push(T const& value) noexcept;
+
+    // Consumer side. The elements ready to be read that are contiguous in
+    // memory, empty if there is none; they stay in the queue until consumed.
+    [[nodiscard]] std::span<const T> peek() noexcept;
+    void consume(std::size_t n) noexcept;
+
+    // Consumer side. Returns false if the queue is empty.
+    bool try_pop(T& value) noexcept;
+
+    [[nodiscard]] std::size_t capacity() const noexcept;
+
+  private:
+    std::vector<T> buffer_;
+    std::size_t mask_;
+
+    // Written by the producer.
+    alignas(host::cache_line) std::atomic<std::size_t> head_{0};
+    std::size_t cached_tail_{0};
+
+    // Written by the consumer.
+    alignas(host::cache_line) std::atomic<std::size_t> tail_{0};
+    std::size_t cached_head_{0};
+};
+
+template <typename T>
+SpscRing<T>::SpscRing(std::size_t capacity)
+    : buffer_(std::bit_ceil(capacity)), mask_{buffer_.size() - 1}
+{
+    assert(capacity > 0);
+}
+
+template <typename T>
+bool SpscRing<T>::try_push(T const& value) noexcept
+{
+    const auto head = head_.load(std::memory_order_relaxed);
+    if (head - cached_tail_ == buffer_.size())
+    {
+        cached_tail_ = tail_.load(std::memory_order_acquire);
+        if (head - cached_tail_ == buffer_.size())
+        {
+            return false;
+        }
+    }
+
+    buffer_[head & mask_] = value;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+std::span<const T> SpscRing<T>::peek() noexcept
+{
+    const auto tail = tail_.load(std::memory_order_relaxed);
+    if (cached_head_ == tail)
+    {
+        cached_head_ = head_.load(std::memory_order_acquire);
+    }
+
+    const auto first = tail & mask_;
+    const auto n     = std::min(cached_head_ - tail, buffer_.size() - first);
+    return std::span<const T>(buffer_).subspan(first, n);
+}
+
+template <typename T>
+void SpscRing<T>::consume(std::size_t n) noexcept
+{
+    tail_.store(tail_.load(std::memory_order_relaxed) + n,
+                std::memory_order_release);
+}
+
+template <typename T>
+bool SpscRing<T>::try_pop(T& value) noexcept
+{
+    const auto ready = peek();
+    if (ready.empty())
+    {
+        return false;
+    }
+    value = ready.front();
+    consume(1);
+    return true;
+}
+
+template <typename T>
+std::size_t SpscRing<T>::capacity() const noexcept
+{
+    return buffer_.size();
+}
+
+} // namespace chip8
+
+#endif // CHIP_8_SPSC_RING
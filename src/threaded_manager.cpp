@@ -0,0 +1,124 @@
+#include "threaded_manager.hpp"
+
+#include "constants.hpp"
+#include "framebuffer.hpp"
+#include "io_manager.hpp"
+#include "keypad.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <thread>
+#include <utility>
+
+namespace chip8
+{
+
+ThreadedManager::ThreadedManager(std::unique_ptr<IOManager> io)
+    : io_{std::move(io)}
+{
+    assert(io_);
+}
+
+ThreadedManager::~ThreadedManager() = default;
+
+void ThreadedManager::present()
+{
+    const bool started = io_->start();
+    start_state_.store(started ? StartState::STARTED : StartState::FAILED,
+                       std::memory_order_release);
+    start_state_.notify_all();
+    if (!started)
+    {
+        return;
+    }
+
+    Framebuffer frame;
+    while (!stop_.load(std::memory_order_acquire))
+    {
+        if (!io_->update())
+        {
+            quit_.store(true, std::memory_order_release);
+            break;
+        }
+
+        keys_.store(io_->get_keys(), std::memory_order_relaxed);
+
+        // The rewind key is a state, the other commands are events that wait
+        // for the emulation thread to take them.
+        const auto command = io_->poll_command();
+        rewind_held_.store(command == Command::REWIND,
+                           std::memory_order_relaxed);
+        if (command != Command::NONE && command != Command::REWIND)
+        {
+            command_.store(command, std::memory_order_relaxed);
+        }
+
+        // With vsync the render blocks until the next refresh, otherwise the
+        // loop waits a little for the next frame instead of spinning.
+        if (frames_.consume(frame))
+        {
+            io_->render(frame);
+        }
+        else
+        {
+            std::this_thread::sleep_for(presenter::idle_sleep);
+        }
+    }
+
+    io_->stop();
+}
+
+bool ThreadedManager::is_running() const noexcept
+{
+    return start_state_.load(std::memory_order_acquire) ==
+               StartState::STARTED &&
+           !quit_.load(std::memory_order_acquire) &&
+           !stop_.load(std::memory_order_acquire);
+}
+
+bool ThreadedManager::start()
+{
+    start_state_.wait(StartState::PENDING, std::memory_order_acquire);
+    return start_state_.load(std::memory_order_acquire) ==
+           StartState::STARTED;
+}
+
+bool ThreadedManager::update() noexcept
+{
+    return is_running();
+}
+
+void ThreadedManager::stop() noexcept
+{
+    stop_.store(true, std::memory_order_release);
+}
+
+Command ThreadedManager::poll_command() noexcept
+{
+    if (const auto command =
+            command_.exchange(Command::NONE, std::memory_order_relaxed);
+        command != Command::NONE)
+    {
+        return command;
+    }
+    return rewind_held_.load(std::memory_order_relaxed) ? Command::REWIND
+                                                        : Command::NONE;
+}
+
+KeyMask ThreadedManager::get_keys() const noexcept
+{
+    return keys_.load(std::memory_order_relaxed);
+}
+
+void ThreadedManager::render(Framebuffer const& framebuffer) noexcept
+{
+    frames_.publish(framebuffer);
+}
+
+void ThreadedManager::set_sound(bool on)
+{
+    io_->set_sound(on);
+}
+
+} // namespace chip8
@@ -0,0 +1,84 @@
+#ifndef CHIP_8_THREADED_MANAGER
+#define CHIP_8_THREADED_MANAGER
+
+#include "constants.hpp"
+#include "framebuffer.hpp"
+#include "io_manager.hpp"
+#include "keypad.hpp"
+#include "triple_buffer.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace chip8
+{
+
+// IOManager that runs another one, e.g. an Sdl2Manager, on a presenter thread,
+// so that a slow present or a vsync wait never stalls the emulation. The
+// emulation thread only touches lock-free state: the frames are published
+// through a TripleBuffer, the keys come back as an atomic KeyMask and the
+// commands as atomic flags. The sound is sent straight to the wrapped
+// IOManager, see IOManager::set_sound().
+//
+// The presenter thread calls present(), which starts the wrapped IOManager,
+// then polls its events and renders the latest frame until the emulation
+// calls stop() or the user quits. start() waits for the wrapped IOManager to
+// be started, so present() must be running, or about to run, by then.
+class ThreadedManager : public IOManager
+{
+  public:
+    explicit ThreadedManager(std::unique_ptr<IOManager> io);
+    ThreadedManager(const ThreadedManager&) = delete;
+    ThreadedManager(ThreadedManager&&)      = delete;
+
+    ~ThreadedManager() override;
+
+    ThreadedManager& operator=(const ThreadedManager&) = delete;
+    ThreadedManager& operator=(ThreadedManager&&)      = delete;
+
+    // Presenter thread.
+    void present();
+
+    // Emulation thread.
+    [[nodiscard]] bool is_running() const noexcept override;
+
+    bool start() override;
+    bool update() noexcept override;
+    void stop() noexcept override;
+
+    Command poll_command() noexcept override;
+
+    [[nodiscard]] KeyMask get_keys() const noexcept override;
+
+    void render(Framebuffer const& framebuffer) noexcept override;
+
+    void set_sound(bool on) override;
+
+  private:
+    enum class StartState : uint8_t
+    {
+        PENDING,
+        STARTED,
+        FAILED
+    };
+
+    // Owned by the presenter thread.
+    std::unique_ptr<IOManager> io_;
+
+    TripleBuffer<Framebuffer> frames_;
+
+    // Written by the presenter thread.
+    std::atomic<StartState> start_state_{StartState::PENDING};
+    std::atomic<bool> quit_{false};
+    std::atomic<KeyMask> keys_{0};
+    std::atomic<Command> command_{Command::NONE};
+    std::atomic<bool> rewind_held_{false};
+
+    // Written by the emulation thread.
+    std::atomic<bool> stop_{false};
+};
+
+} // namespace chip8
+
+#endif // CHIP_8_THREADED_MANAGER
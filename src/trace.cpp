@@ -0,0 +1,140 @@
+#include "trace.hpp"
+
+#include "constants.hpp"
+
+#include <cstddef>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace chip8
+{
+
+std::string_view to_string(TraceError error) noexcept
+{
+    switch (error)
+    {
+        using enum TraceError;
+    case FILE_NOT_FOUND:
+        return "trace not found";
+    case WRITE_FAILED:
+        return "cannot write the trace";
+    case INVALID_FORMAT:
+        return "not a valid trace";
+    case UNSUPPORTED_VERSION:
+        return "unsupported trace version";
+    }
+    return "unknown error";
+}
+
+Tracer::Tracer(std::string const& path, Config const& config)
+    : ring_{config.capacity},
+      file_{path, std::ios::binary | std::ios::trunc},
+      overflow_{config.overflow}
+{
+    const TraceHeader header{.magic       = TraceHeader::expected_magic,
+                             .version     = TraceHeader::current_version,
+                             .record_size = sizeof(TraceRecord)};
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    good_ = file_.good();
+    if (good_)
+    {
+        writer_ = std::jthread(
+            [this](std::stop_token const& stop) { drain(stop); });
+    }
+}
+
+Tracer::~Tracer()
+{
+    finish();
+}
+
+bool Tracer::finish()
+{
+    if (writer_.joinable())
+    {
+        writer_.request_stop();
+        writer_.join();
+    }
+    if (file_.is_open())
+    {
+        file_.close();
+    }
+    return good_ && !file_.fail();
+}
+
+void Tracer::push_blocking(TraceRecord const& record) noexcept
+{
+    while (!ring_.try_push(record))
+    {
+        std::this_thread::yield();
+    }
+}
+
+void Tracer::drain(std::stop_token const& stop)
+{
+    while (true)
+    {
+        // Checked before looking at the ring: the records pushed before the
+        // stop was requested are then guaranteed to be seen.
+        const bool stopping = stop.stop_requested();
+
+        const auto records = ring_.peek();
+        if (records.empty())
+        {
+            if (stopping)
+            {
+                break;
+            }
+            std::this_thread::sleep_for(trace::drain_interval);
+            continue;
+        }
+
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        file_.write(reinterpret_cast<const char*>(records.data()),
+                    static_cast<std::streamsize>(records.size_bytes()));
+        ring_.consume(records.size());
+    }
+    file_.flush();
+}
+
+TraceReader::TraceReader(std::string const& path)
+    : file_{path, std::ios::binary}
+{
+    if (!file_.is_open())
+    {
+        error_ = TraceError::FILE_NOT_FOUND;
+        return;
+    }
+
+    TraceHeader header;
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    file_.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file_ || header.magic != TraceHeader::expected_magic)
+    {
+        error_ = TraceError::INVALID_FORMAT;
+    }
+    else if (header.version != TraceHeader::current_version ||
+             header.record_size != sizeof(TraceRecord))
+    {
+        error_ = TraceError::UNSUPPORTED_VERSION;
+    }
+}
+
+bool TraceReader::next(TraceRecord& record)
+{
+    if (error_)
+    {
+        return false;
+    }
+    // A record cut by an interrupted write is ignored.
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    file_.read(reinterpret_cast<char*>(&record), sizeof(record));
+    return static_cast<bool>(file_);
+}
+
+} // namespace chip8
@@ -0,0 +1,202 @@
+#ifndef CHIP_8_TRACE
+#define CHIP_8_TRACE
+
+#include "constants.hpp"
+#include "spsc_ring.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+namespace chip8
+{
+
+// An instruction trace holds one fixed-size record per executed instruction.
+// The emulator thread appends the records to a lock-free ring, from which a
+// background thread writes them to the file, so that tracing costs a copy of
+// the record per instruction.
+//
+// File layout, with the same conventions of SaveState:
+//   TraceHeader
+//   TraceRecord, repeated until the end of the file.
+
+enum class TraceError : uint8_t
+{
+    FILE_NOT_FOUND,
+    WRITE_FAILED,
+    INVALID_FORMAT,
+    UNSUPPORTED_VERSION
+};
+
+std::string_view to_string(TraceError error) noexcept;
+
+// What the emulator does when the writer thread falls behind and the ring is
+// full.
+enum class TraceOverflow : uint8_t
+{
+    // The record is discarded and the next one is marked, the emulation
+    // speed is not affected.
+    DROP,
+    // The emulator waits for the writer thread, no record is lost.
+    BLOCK
+};
+
+struct TraceHeader
+{
+    static constexpr std::array<char, 4> expected_magic{'C', '8', 'T', 'R'};
+    static constexpr uint16_t current_version = 1;
+
+    std::array<char, 4> magic{expected_magic};
+    uint16_t version{current_version};
+    uint16_t record_size{};
+};
+
+struct TraceRecord
+{
+    // Set if records were dropped right before this one.
+    static constexpr uint8_t dropped_flag = 0x01;
+
+    // Instructions executed since the trace started, before this one.
+    uint64_t cycle{};
+    // Address and opcode of the instruction.
+    uint16_t pc{};
+    uint16_t opcode{};
+    // I and V registers after the instruction was executed. The registers it
+    // changed are found comparing them with the previous record.
+    uint16_t index{};
+    uint8_t flags{};
+    uint8_t reserved{};
+    std::array<uint8_t, cpu::n_registers> registers{};
+};
+
+static_assert(std::has_unique_object_representations_v<TraceHeader>);
+static_assert(std::has_unique_object_representations_v<TraceRecord>);
+static_assert(sizeof(TraceRecord) == 32, "two records per cache line");
+
+struct TracerConfig
+{
+    // Records the ring holds, rounded up to a power of two.
+    std::size_t capacity   = trace::ring_capacity;
+    TraceOverflow overflow = TraceOverflow::BLOCK;
+};
+
+// Writes an instruction trace while the emulator runs. record() must always
+// be called from the same thread.
+class Tracer
+{
+  public:
+    using Config = TracerConfig;
+
+    // The file is created and the writer thread started as soon as the tracer
+    // is constructed, check good() before using it.
+    Tracer(std::string const& path, Config const& config);
+    Tracer(Tracer const&) = delete;
+    Tracer(Tracer&&)      = delete;
+
+    ~Tracer();
+
+    Tracer& operator=(Tracer const&) = delete;
+    Tracer& operator=(Tracer&&)      = delete;
+
+    [[nodiscard]] bool good() const noexcept;
+
+    void record(
+        uint16_t pc, uint16_t opcode, uint16_t index,
+        std::array<uint8_t, cpu::n_registers> const& registers) noexcept;
+
+    // Writes the records still in the ring and closes the file. Returns false
+    // if any write failed.
+    bool finish();
+
+    // Records discarded because the ring was full.
+    [[nodiscard]] uint64_t get_dropped() const noexcept;
+
+  private:
+    void push_blocking(TraceRecord const& record) noexcept;
+
+    void drain(std::stop_token const& stop);
+
+    SpscRing<TraceRecord> ring_;
+    // Only used by the writer thread once it is started.
+    std::ofstream file_;
+    bool good_{false};
+    TraceOverflow overflow_;
+
+    uint64_t cycle_{0};
+    uint64_t dropped_{0};
+    bool gap_{false};
+
+    std::jthread writer_;
+};
+
+inline bool Tracer::good() const noexcept
+{
+    return good_;
+}
+
+inline void Tracer::record(
+    uint16_t pc, uint16_t opcode, uint16_t index,
+    std::array<uint8_t, cpu::n_registers> const& registers) noexcept
+{
+    const TraceRecord record{
+        .cycle     = cycle_++,
+        .pc        = pc,
+        .opcode    = opcode,
+        .index     = index,
+        .flags     = gap_ ? TraceRecord::dropped_flag : uint8_t{0},
+        .reserved  = 0,
+        .registers = registers};
+
+    if (ring_.try_push(record))
+    {
+        gap_ = false;
+    }
+    else if (overflow_ == TraceOverflow::DROP)
+    {
+        ++dropped_;
+        gap_ = true;
+    }
+    else
+    {
+        push_blocking(record);
+        gap_ = false;
+    }
+}
+
+inline uint64_t Tracer::get_dropped() const noexcept
+{
+    return dropped_;
+}
+
+// Reads a trace one record at a time.
+class TraceReader
+{
+  public:
+    explicit TraceReader(std::string const& path);
+
+    // Set if the file is not a readable trace, in which case next() returns
+    // false.
+    [[nodiscard]] std::optional<TraceError> get_error() const noexcept;
+
+    // Reads the next record, returns false at the end of the trace.
+    bool next(TraceRecord& record);
+
+  private:
+    std::ifstream file_;
+    std::optional<TraceError> error_;
+};
+
+inline std::optional<TraceError> TraceReader::get_error() const noexcept
+{
+    return error_;
+}
+
+} // namespace chip8
+
+#endif // CHIP_8_TRACE
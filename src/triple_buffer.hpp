@@ -0,0 +1,71 @@
+#ifndef CHIP_8_TRIPLE_BUFFER
+#define CHIP_8_TRIPLE_BUFFER
+
+#include "constants.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+namespace chip8
+{
+
+// Lock-free hand-off of the latest value from one writer thread to one reader
+// thread. The writer fills its own slot and swaps it with the shared middle
+// slot, the reader swaps its own slot with the middle one when a new value was
+// published. Neither side ever waits for the other: values the reader did not
+// pick in time are overwritten, and the reader keeps the last value it got.
+template <typename T>
+class TripleBuffer
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+
+  public:
+    // Writer side.
+    void publish(T const& value) noexcept;
+
+    // Reader side. Returns true, and the value in out, if a value was
+    // published since the last call.
+    bool consume(T& out) noexcept;
+
+  private:
+    // Set in middle_ when the middle slot holds a value not yet consumed.
+    static constexpr uint8_t fresh_flag = 0x4;
+    static constexpr uint8_t index_mask = 0x3;
+
+    std::array<T, 3> slots_{};
+
+    alignas(host::cache_line) std::atomic<uint8_t> middle_{1};
+    // Owned by the writer.
+    alignas(host::cache_line) uint8_t back_{0};
+    // Owned by the reader.
+    alignas(host::cache_line) uint8_t front_{2};
+};
+
+template <typename T>
+void TripleBuffer<T>::publish(T const& value) noexcept
+{
+    slots_[back_]       = value;
+    const auto previous = middle_.exchange(
+        static_cast<uint8_t>(back_ | fresh_flag), std::memory_order_acq_rel);
+    back_ = previous & index_mask;
+}
+
+template <typename T>
+bool TripleBuffer<T>::consume(T& out) noexcept
+{
+    if ((middle_.load(std::memory_order_relaxed) & fresh_flag) == 0)
+    {
+        return false;
+    }
+    const auto previous =
+        middle_.exchange(front_, std::memory_order_acq_rel);
+    front_ = previous & index_mask;
+    out    = slots_[front_];
+    return true;
+}
+
+} // namespace chip8
+
+#endif // CHIP_8_TRIPLE_BUFFER
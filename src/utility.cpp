@@ -1,52 +1,165 @@
 #include "utility.hpp"
 
+#include "constants.hpp"
+#include "cpu.hpp"
+#include "keypad.hpp"
+#include "quirks.hpp"
+#include "trace.hpp"
+
+#include <array>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
 #include <cstdint>
+#include <ctime>
 #include <cxxopts.hpp>
 #include <fcntl.h>
 #include <iostream>
-#include <limits>
+#include <optional>
 #include <print>
-#include <random>
 #include <string>
 #include <termios.h>
+#include <thread>
 #include <unistd.h>
 
 namespace chip8::utility
 {
 
-uint8_t random_byte()
+void sleep_until(std::chrono::steady_clock::time_point deadline)
 {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    static std::uniform_int_distribution<uint8_t> dist(
-        std::numeric_limits<uint8_t>::min(),
-        std::numeric_limits<uint8_t>::max());
-    auto number = dist(gen);
-    return static_cast<uint8_t>(number);
+#if defined(_POSIX_MONOTONIC_CLOCK) && _POSIX_MONOTONIC_CLOCK >= 0
+    // steady_clock is backed by CLOCK_MONOTONIC on POSIX systems, so the
+    // deadline can be handed directly to the kernel as an absolute time.
+    using namespace std::chrono;
+
+    const auto since_epoch = deadline.time_since_epoch();
+    const auto secs        = duration_cast<seconds>(since_epoch);
+    const auto nsecs       = duration_cast<nanoseconds>(since_epoch - secs);
+
+    timespec ts{};
+    ts.tv_sec  = static_cast<time_t>(secs.count());
+    ts.tv_nsec = static_cast<long>(nsecs.count());
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) ==
+           EINTR)
+    {
+    }
+#else
+    std::this_thread::sleep_until(deadline);
+#endif
 }
 
 namespace argparse
 {
 
+std::optional<CpuBackend> parse_cpu_backend(std::string_view name)
+{
+    if (name == "interpreter")
+    {
+        return CpuBackend::INTERPRETER;
+    }
+    if (name == "blocks")
+    {
+        return CpuBackend::BLOCKS;
+    }
+    if (name == "jit")
+    {
+        return CpuBackend::JIT;
+    }
+    return std::nullopt;
+}
+
+std::optional<Profile> parse_profile(std::string_view name)
+{
+    if (name == "default")
+    {
+        return Profile::DEFAULT;
+    }
+    if (name == "cosmac-vip")
+    {
+        return Profile::COSMAC_VIP;
+    }
+    if (name == "super-chip")
+    {
+        return Profile::SUPER_CHIP;
+    }
+    if (name == "xo-chip")
+    {
+        return Profile::XO_CHIP;
+    }
+    return std::nullopt;
+}
+
 // NOLINTNEXTLINE(modernize-avoid-c-arrays)
 ParseResult parse(int argc, char* argv[])
 {
     cxxopts::Options options(PROGRAM_NAME, PROGRAM_NAME " " PROGRAM_VERSION);
 
-    constexpr std::string_view rom_opt       = "rom";
-    constexpr std::string_view rate_opt      = "rate";
-    constexpr std::string_view input_map_opt = "input-mapping";
-    constexpr std::string_view help_opt      = "help";
-    constexpr std::string_view version_opt   = "version";
+    constexpr std::string_view rom_opt        = "rom";
+    constexpr std::string_view state_opt      = "load-state";
+    constexpr std::string_view record_opt     = "record";
+    constexpr std::string_view replay_opt     = "replay";
+    constexpr std::string_view seek_opt       = "seek";
+    constexpr std::string_view rate_opt       = "rate";
+    constexpr std::string_view cycles_opt     = "cycles";
+    constexpr std::string_view headless_opt   = "headless";
+    constexpr std::string_view turbo_opt      = "turbo";
+    constexpr std::string_view cpu_opt        = "cpu";
+    constexpr std::string_view profile_opt    = "profile";
+    constexpr std::string_view seed_opt       = "seed";
+    constexpr std::string_view rewind_opt     = "rewind";
+    constexpr std::string_view stats_opt      = "stats";
+    constexpr std::string_view stats_json_opt = "stats-json";
+    constexpr std::string_view trace_opt      = "trace";
+    constexpr std::string_view overflow_opt   = "trace-overflow";
+    constexpr std::string_view key_map_opt    = "keymap";
+    constexpr std::string_view input_map_opt  = "input-mapping";
+    constexpr std::string_view help_opt       = "help";
+    constexpr std::string_view version_opt    = "version";
 
     // NOLINTBEGIN(bugprone-suspicious-stringview-data-usage)
 
     // clang-format off
     options.add_options()
         (std::string("r,") + rate_opt.data(), "Instructions per second",
-            cxxopts::value<uint16_t>()->default_value("500"))
+            cxxopts::value<uint32_t>()->default_value("500"))
         (std::string("f,") + rom_opt.data(), "Path to the ROM file to load",
             cxxopts::value<std::string>())
+        (state_opt.data(), "Path to a save state to restore at startup",
+            cxxopts::value<std::string>()->default_value(""))
+        (record_opt.data(), "Record the inputs of the run to the given file",
+            cxxopts::value<std::string>()->default_value(""))
+        (replay_opt.data(), "Replay the given recording, no ROM is needed",
+            cxxopts::value<std::string>()->default_value(""))
+        (seek_opt.data(), "Frame of the recording the replay starts from",
+            cxxopts::value<uint64_t>()->default_value("0"))
+        (std::string("c,") + cycles_opt.data(),
+            "Stop after the given number of instructions (0 = no limit)",
+            cxxopts::value<uint64_t>()->default_value("0"))
+        (headless_opt.data(), "Run without window, audio and input")
+        (turbo_opt.data(), "Run instructions as fast as possible")
+        (cpu_opt.data(), "CPU backend: interpreter, blocks or jit",
+            cxxopts::value<std::string>()->default_value("interpreter"))
+        (profile_opt.data(),
+            "Quirks: default, cosmac-vip, super-chip or xo-chip",
+            cxxopts::value<std::string>()->default_value("default"))
+        (seed_opt.data(), "Seed of the random numbers (default: random)",
+            cxxopts::value<uint64_t>())
+        (rewind_opt.data(), "Seconds that can be rewound (0 = disabled)",
+            cxxopts::value<uint32_t>()->default_value(
+                std::to_string(rewind::default_seconds)))
+        (stats_opt.data(), "Print executions and time of every opcode at exit")
+        (stats_json_opt.data(), "Write the opcode stats as JSON to the file",
+            cxxopts::value<std::string>()->default_value(""))
+        (trace_opt.data(), "Write a trace of the executed instructions",
+            cxxopts::value<std::string>()->default_value(""))
+        (overflow_opt.data(),
+            "When the trace falls behind: block the emulator or drop records",
+            cxxopts::value<std::string>()->default_value("block"))
+        (key_map_opt.data(),
+            "Host keys of the keypad keys 0 to F, e.g. x123qweasdzc4rfv",
+            cxxopts::value<std::string>()->default_value(
+                std::string(input::default_layout)))
         (std::string("i,") + input_map_opt.data(), "Show input mapping")
         (std::string("h,") + help_opt.data(), "Print help information")
         (std::string("v,") + version_opt.data(), "Print version information");
@@ -73,25 +186,109 @@ ParseResult parse(int argc, char* argv[])
             return empty_options;
         }
 
+        const auto key_map =
+            parse_key_map(result[key_map_opt.data()].as<std::string>());
+        if (!key_map)
+        {
+            std::print(std::cerr, "Error: the key map must have 16 distinct "
+                                  "keys, use --help for more info\n");
+            return ParseError::ParseError;
+        }
+
         if (result.contains(input_map_opt.data()))
         {
+            // The keypad keys in the order they are laid out.
+            constexpr std::array<std::array<uint8_t, 4>, 4> keypad{
+                {{0x1, 0x2, 0x3, 0xc},
+                 {0x4, 0x5, 0x6, 0xd},
+                 {0x7, 0x8, 0x9, 0xe},
+                 {0xa, 0x0, 0xb, 0xf}}};
+
+            const auto host = [&](uint8_t key) {
+                return static_cast<char>(std::toupper(
+                    static_cast<unsigned char>(key_map->key_of(key))));
+            };
+
             std::println("CHIP-8 Input Mapping:\n");
-            std::println("  1 2 3 4  ->  1 2 3 C");
-            std::println("  Q W E R  ->  4 5 6 D");
-            std::println("  A S D F  ->  7 8 9 E");
-            std::println("  Z X C V  ->  A 0 B F");
+            for (auto const& row : keypad)
+            {
+                std::println("  {} {} {} {}  ->  {:X} {:X} {:X} {:X}",
+                             host(row[0]), host(row[1]), host(row[2]),
+                             host(row[3]), row[0], row[1], row[2], row[3]);
+            }
+            std::println("\n  F5 saves the state, F9 restores it");
+            std::println("  Hold Backspace to rewind");
             return empty_options;
         }
 
-        if (!result.contains(rom_opt.data()))
+        const auto replay = result[replay_opt.data()].as<std::string>();
+        if (!result.contains(rom_opt.data()) && replay.empty())
         {
             std::print(std::cerr,
                        "Error: ROM is required, use --help for more info\n");
             return ParseError::MissingRom;
         }
 
-        return Options{.rom  = result[rom_opt.data()].as<std::string>(),
-                       .rate = result[rate_opt.data()].as<uint16_t>()};
+        const auto rate = result[rate_opt.data()].as<uint32_t>();
+        if (rate == 0)
+        {
+            std::print(std::cerr, "Error: the rate must not be 0, use --help "
+                                  "for more info\n");
+            return ParseError::ParseError;
+        }
+
+        const auto cpu =
+            parse_cpu_backend(result[cpu_opt.data()].as<std::string>());
+        if (!cpu)
+        {
+            std::print(
+                std::cerr,
+                "Error: unknown CPU backend, use --help for more info\n");
+            return ParseError::ParseError;
+        }
+
+        const auto profile =
+            parse_profile(result[profile_opt.data()].as<std::string>());
+        if (!profile)
+        {
+            std::print(std::cerr,
+                       "Error: unknown profile, use --help for more info\n");
+            return ParseError::ParseError;
+        }
+
+        const auto overflow = result[overflow_opt.data()].as<std::string>();
+        if (overflow != "block" && overflow != "drop")
+        {
+            std::print(std::cerr, "Error: unknown trace overflow policy, use "
+                                  "--help for more info\n");
+            return ParseError::ParseError;
+        }
+
+        return Options{
+            .rom            = result.contains(rom_opt.data())
+                                  ? result[rom_opt.data()].as<std::string>()
+                                  : std::string{},
+            .state          = result[state_opt.data()].as<std::string>(),
+            .record         = result[record_opt.data()].as<std::string>(),
+            .replay         = replay,
+            .seek           = result[seek_opt.data()].as<uint64_t>(),
+            .rate           = rate,
+            .cycles         = result[cycles_opt.data()].as<uint64_t>(),
+            .headless       = result[headless_opt.data()].as<bool>(),
+            .turbo          = result[turbo_opt.data()].as<bool>(),
+            .cpu            = *cpu,
+            .profile        = *profile,
+            .seed           = result.contains(seed_opt.data())
+                                  ? std::optional{result[seed_opt.data()]
+                                                      .as<uint64_t>()}
+                                  : std::nullopt,
+            .rewind         = result[rewind_opt.data()].as<uint32_t>(),
+            .stats          = result[stats_opt.data()].as<bool>(),
+            .stats_json     = result[stats_json_opt.data()].as<std::string>(),
+            .trace          = result[trace_opt.data()].as<std::string>(),
+            .trace_overflow = overflow == "drop" ? TraceOverflow::DROP
+                                                 : TraceOverflow::BLOCK,
+            .key_map        = *key_map};
 
         // NOLINTEND(bugprone-suspicious-stringview-data-usage)
     }
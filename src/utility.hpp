@@ -1,11 +1,23 @@
 #ifndef CHIP_8_UTILITY
 #define CHIP_8_UTILITY
 
+#include "keypad.hpp"
+
 #include <array>
+#include <chrono>
 #include <cstdint>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <variant>
 
+namespace chip8
+{
+enum class CpuBackend : uint8_t;
+enum class Profile : uint8_t;
+enum class TraceOverflow : uint8_t;
+} // namespace chip8
+
 namespace chip8::utility
 {
 
@@ -23,7 +35,9 @@ struct Color
 static constexpr Color white{.r = 255, .g = 255, .b = 255, .a = 255};
 static constexpr Color black{.r = 0, .g = 0, .b = 0, .a = 255};
 
-uint8_t random_byte();
+// Suspends the calling thread until the given absolute time point. Sleeping to
+// an absolute deadline avoids accumulating the drift of relative sleeps.
+void sleep_until(std::chrono::steady_clock::time_point deadline);
 
 namespace argparse
 {
@@ -31,7 +45,32 @@ namespace argparse
 struct Options
 {
     std::string rom;
-    uint16_t rate{};
+    // Save state restored after loading the ROM, none if empty.
+    std::string state;
+    // Recording to write and to replay, none if empty. A replay does not need
+    // a ROM and starts from the frame seek.
+    std::string record;
+    std::string replay;
+    uint64_t seek{};
+    uint32_t rate{};
+    uint64_t cycles{};
+    bool headless{};
+    bool turbo{};
+    CpuBackend cpu{};
+    Profile profile{};
+    // Seed of the random generator, a random one if not given.
+    std::optional<uint64_t> seed;
+    // Seconds of gameplay that can be rewound, 0 disables rewinding.
+    uint32_t rewind{};
+    // Print the per-opcode stats at exit as a table and write them as JSON to
+    // stats_json, if not empty.
+    bool stats{};
+    std::string stats_json;
+    // Instruction trace to write, none if empty, and what to do when the
+    // trace cannot be written as fast as the emulator runs.
+    std::string trace;
+    TraceOverflow trace_overflow{};
+    KeyMap key_map{};
 };
 
 struct EmptyOptions
@@ -47,6 +86,12 @@ enum class ParseError : uint8_t
 
 using ParseResult = std::variant<Options, EmptyOptions, ParseError>;
 
+// Maps the name of a CPU backend used on the command line to its value.
+std::optional<CpuBackend> parse_cpu_backend(std::string_view name);
+
+// Maps the name of a quirk profile used on the command line to its value.
+std::optional<Profile> parse_profile(std::string_view name);
+
 // NOLINTNEXTLINE(modernize-avoid-c-arrays)
 ParseResult parse(int argc, char* argv[]);
 
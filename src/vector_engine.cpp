@@ -0,0 +1,529 @@
+#include "vector_engine.hpp"
+
+#include "constants.hpp"
+#include "decoder.hpp"
+#include "framebuffer.hpp"
+#include "keypad.hpp"
+#include "machine_state.hpp"
+#include "random.hpp"
+#include "rom_store.hpp"
+#include "save_state.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <span>
+
+namespace chip8
+{
+
+namespace
+{
+
+static_assert(std::has_single_bit(memory::size));
+static_assert(std::has_single_bit(std::size_t{cpu::stack_size}));
+
+// Number of instructions to execute in the given frame, see Chip8.
+uint64_t cycles_in_frame(uint32_t rate, uint64_t frame) noexcept
+{
+    const uint64_t frame_in_second = frame % timer::fps;
+    return (frame_in_second + 1) * rate / timer::fps -
+           frame_in_second * rate / timer::fps;
+}
+
+// Amount to add to the program counter to skip the next instruction if cond.
+uint16_t skip_if(bool cond) noexcept
+{
+    return cond ? memory::instruction_size : 0;
+}
+
+} // namespace
+
+VectorEngine::VectorEngine(Config const& config)
+    : n_{config.instances}, rate_{config.rate}, seed_{config.seed},
+      v_(cpu::n_registers * config.instances), pc_(config.instances),
+      index_(config.instances), stack_(config.instances),
+      stack_ptr_(config.instances), delay_timer_(config.instances),
+      sound_timer_(config.instances), keys_(config.instances),
+      random_(config.instances), framebuffers_(config.instances),
+      memory_(config.instances), dirty_(config.instances)
+{
+    assert(n_ > 0);
+
+    std::ranges::copy(font::built_in, image_.begin() + memory::font_address);
+    reset();
+}
+
+std::expected<void, LoadRomError> VectorEngine::load_rom(
+    std::span<const uint8_t> rom)
+{
+    if (auto res = validate_rom(rom); !res)
+    {
+        return res;
+    }
+
+    image_.fill(0);
+    std::ranges::copy(font::built_in, image_.begin() + memory::font_address);
+    std::ranges::copy(rom, image_.begin() + memory::free_address);
+    reset();
+
+    return {};
+}
+
+void VectorEngine::step(uint64_t n_frames, std::span<const KeyMask> key_masks)
+{
+    assert(key_masks.size() == n_);
+
+    std::ranges::copy(key_masks, keys_.begin());
+    for (uint64_t frame = 0; frame < n_frames; ++frame)
+    {
+        const auto cycles = cycles_in_frame(rate_, frames_);
+        for (uint64_t i = 0; i < cycles; ++i)
+        {
+            cycle();
+        }
+        update_timers();
+        ++frames_;
+    }
+}
+
+SaveState VectorEngine::save_state(std::size_t lane) const noexcept
+{
+    SaveState state;
+    state.framebuffer = framebuffers_[lane];
+    state.memory      = memory_[lane];
+
+    auto& cpu = state.cpu;
+    for (uint8_t x = 0; x < cpu::n_registers; ++x)
+    {
+        cpu.registers[x] = reg(x)[lane];
+    }
+    cpu.index       = index_[lane];
+    cpu.pc          = pc_[lane] & memory::address_mask;
+    cpu.stack       = stack_[lane];
+    cpu.stack_ptr   = stack_ptr_[lane];
+    cpu.delay_timer = delay_timer_[lane];
+    cpu.sound_timer = sound_timer_[lane];
+    cpu.random      = random_[lane];
+
+    return state;
+}
+
+std::expected<void, StateError> VectorEngine::load_state(
+    std::size_t lane, SaveState const& state)
+{
+    if (auto res = validate(state); !res)
+    {
+        return res;
+    }
+
+    framebuffers_[lane] = state.framebuffer;
+    memory_[lane]       = state.memory;
+
+    auto const& cpu = state.cpu;
+    for (uint8_t x = 0; x < cpu::n_registers; ++x)
+    {
+        reg(x)[lane] = cpu.registers[x];
+    }
+    index_[lane]       = cpu.index;
+    pc_[lane]          = cpu.pc;
+    stack_[lane]       = cpu.stack;
+    stack_ptr_[lane]   = cpu.stack_ptr;
+    delay_timer_[lane] = cpu.delay_timer;
+    sound_timer_[lane] = cpu.sound_timer;
+    random_[lane]      = cpu.random;
+
+    // The state may come from another ROM, or from a later point of this one,
+    // so its memory is compared with the image line by line.
+    dirty_[lane] = 0;
+    for (std::size_t line = 0; line < memory::size / line_size; ++line)
+    {
+        const auto first = line * line_size;
+        if (!std::equal(image_.begin() + first,
+                        image_.begin() + first + line_size,
+                        state.memory.begin() + first))
+        {
+            dirty_[lane] |= uint64_t{1} << line;
+        }
+    }
+    update_dirty();
+
+    return {};
+}
+
+void VectorEngine::reset() noexcept
+{
+    for (uint16_t address = 0; address < memory::size;
+         address += memory::instruction_size)
+    {
+        // NOLINTNEXTLINE(hicpp-signed-bitwise)
+        decoded_[address / memory::instruction_size] = decode(
+            static_cast<uint16_t>((image_[address] << memory::byte) |
+                                  image_[address + 1]));
+    }
+
+    std::ranges::fill(v_, 0);
+    std::ranges::fill(pc_, memory::free_address);
+    std::ranges::fill(index_, 0);
+    std::ranges::fill(stack_, std::array<uint16_t, cpu::stack_size>{});
+    std::ranges::fill(stack_ptr_, -1);
+    std::ranges::fill(delay_timer_, 0);
+    std::ranges::fill(sound_timer_, 0);
+    for (std::size_t lane = 0; lane < n_; ++lane)
+    {
+        random_[lane].seed(seed_ + lane);
+    }
+    std::ranges::fill(framebuffers_, Framebuffer{});
+    std::ranges::fill(memory_, image_);
+    std::ranges::fill(dirty_, 0);
+    dirty_any_ = 0;
+    frames_    = 0;
+}
+
+void VectorEngine::cycle() noexcept
+{
+    // Like Cpu::fetch(), wraps the pc of every lane around the end of memory
+    // first, so that the lanes keep the pc of Chip8 and stay in lockstep.
+    for (auto& lane_pc : pc_)
+    {
+        lane_pc &= memory::address_mask;
+    }
+
+    // Branchless, so that the comparison of the lanes is vectorized too.
+    const uint16_t pc  = pc_[0];
+    uint16_t diverging = 0;
+    for (const auto lane_pc : pc_)
+    {
+        // NOLINTNEXTLINE(hicpp-signed-bitwise)
+        diverging |= lane_pc ^ pc;
+    }
+
+    if (diverging == 0 && is_shared(pc, dirty_any_))
+    {
+        const auto next = static_cast<uint16_t>(pc + memory::instruction_size);
+        std::ranges::fill(pc_, next);
+        execute(decoded_[pc / memory::instruction_size], 0, n_);
+        return;
+    }
+
+    for (std::size_t lane = 0; lane < n_; ++lane)
+    {
+        const auto instr = fetch(lane);
+        pc_[lane] += memory::instruction_size;
+        execute(instr, lane, lane + 1);
+    }
+}
+
+void VectorEngine::execute(DecodedInstruction const& instr, std::size_t first,
+                           std::size_t last) noexcept
+{
+    auto* vx = reg(instr.x);
+    auto* vy = reg(instr.y);
+    // NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+    auto* vf = reg(0xf);
+    auto* v0 = reg(0x0);
+    auto* pc = pc_.data();
+
+    const auto nn  = instr.nn;
+    const auto nnn = instr.nnn;
+
+    // Every case reads the operands of a lane before writing its results, as
+    // Cpu does, so that Vx, Vy and VF may be the same register.
+    switch (instr.op)
+    {
+    case Op::CLS:
+        for (auto i = first; i < last; ++i)
+        {
+            framebuffers_[i].rows.fill(0);
+        }
+        break;
+    case Op::RET:
+        for (auto i = first; i < last; ++i)
+        {
+            pc[i] = stack_[i][stack_slot(stack_ptr_[i]--)];
+        }
+        break;
+    case Op::JP_NNN:
+        std::fill(pc + first, pc + last, nnn);
+        break;
+    case Op::CALL:
+        for (auto i = first; i < last; ++i)
+        {
+            stack_[i][stack_slot(++stack_ptr_[i])] = pc[i];
+            pc[i]                                 = nnn;
+        }
+        break;
+    case Op::SE_VX_NN:
+        for (auto i = first; i < last; ++i)
+        {
+            pc[i] += skip_if(vx[i] == nn);
+        }
+        break;
+    case Op::SNE_VX_NN:
+        for (auto i = first; i < last; ++i)
+        {
+            pc[i] += skip_if(vx[i] != nn);
+        }
+        break;
+    case Op::SE_VX_VY:
+        for (auto i = first; i < last; ++i)
+        {
+            pc[i] += skip_if(vx[i] == vy[i]);
+        }
+        break;
+    case Op::LD_VX_NN:
+        std::fill(vx + first, vx + last, nn);
+        break;
+    case Op::ADD_VX_NN:
+        for (auto i = first; i < last; ++i)
+        {
+            vx[i] += nn;
+        }
+        break;
+    case Op::LD_VX_VY:
+        for (auto i = first; i < last; ++i)
+        {
+            vx[i] = vy[i];
+        }
+        break;
+    case Op::OR_VX_VY:
+        for (auto i = first; i < last; ++i)
+        {
+            vx[i] |= vy[i];
+        }
+        break;
+    case Op::AND_VX_VY:
+        for (auto i = first; i < last; ++i)
+        {
+            vx[i] &= vy[i];
+        }
+        break;
+    case Op::XOR_VX_VY:
+        for (auto i = first; i < last; ++i)
+        {
+            vx[i] ^= vy[i];
+        }
+        break;
+    case Op::ADD_VX_VY:
+        for (auto i = first; i < last; ++i)
+        {
+            const uint16_t sum = vx[i] + vy[i];
+            vx[i]              = static_cast<uint8_t>(sum);
+            vf[i]              = static_cast<uint8_t>(sum >> memory::byte);
+        }
+        break;
+    case Op::SUB_VX_VY:
+        for (auto i = first; i < last; ++i)
+        {
+            const uint8_t a = vx[i];
+            const uint8_t b = vy[i];
+            vx[i]           = static_cast<uint8_t>(a - b);
+            vf[i]           = static_cast<uint8_t>(a >= b);
+        }
+        break;
+    case Op::SHR_VX_VY:
+        for (auto i = first; i < last; ++i)
+        {
+            const uint8_t a = vx[i];
+            vx[i]           = static_cast<uint8_t>(a >> 1U);
+            vf[i]           = a & mask::less_significant_bit;
+        }
+        break;
+    case Op::SUBN_VX_VY:
+        for (auto i = first; i < last; ++i)
+        {
+            const uint8_t a = vx[i];
+            const uint8_t b = vy[i];
+            vx[i]           = static_cast<uint8_t>(b - a);
+            vf[i]           = static_cast<uint8_t>(b >= a);
+        }
+        break;
+    case Op::SHL_VX_VY:
+        for (auto i = first; i < last; ++i)
+        {
+            const uint8_t a = vx[i];
+            vx[i]           = static_cast<uint8_t>(a << 1U);
+            // NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+            vf[i] = static_cast<uint8_t>(a >> 7U);
+        }
+        break;
+    case Op::SNE_VX_VY:
+        for (auto i = first; i < last; ++i)
+        {
+            pc[i] += skip_if(vx[i] != vy[i]);
+        }
+        break;
+    case Op::LD_I_NNN:
+        std::fill(index_.begin() + first, index_.begin() + last, nnn);
+        break;
+    case Op::JP_V0_NNN:
+        for (auto i = first; i < last; ++i)
+        {
+            pc[i] = v0[i] + nnn;
+        }
+        break;
+    case Op::RND_VX_NN:
+        for (auto i = first; i < last; ++i)
+        {
+            vx[i] = random_[i].next_byte() & nn;
+        }
+        break;
+    case Op::DRW_VX_VY_N:
+        for (auto i = first; i < last; ++i)
+        {
+            const auto x       = vx[i];
+            const auto y       = vy[i];
+            const auto address = index_[i] & memory::address_mask;
+            const auto sprite  = std::span{memory_[i]}.subspan(
+                address, std::min<std::size_t>(instr.n,
+                                               memory::size - address));
+            vf[i] = draw_sprite(framebuffers_[i], x, y, sprite) ? 1 : 0;
+        }
+        break;
+    case Op::SKP_VX:
+        for (auto i = first; i < last; ++i)
+        {
+            pc[i] += skip_if(is_pressed(keys_[i], vx[i]));
+        }
+        break;
+    case Op::NSKP_VX:
+        for (auto i = first; i < last; ++i)
+        {
+            pc[i] += skip_if(!is_pressed(keys_[i], vx[i]));
+        }
+        break;
+    case Op::LD_VX_DT:
+        std::copy(delay_timer_.begin() + first, delay_timer_.begin() + last,
+                  vx + first);
+        break;
+    case Op::LD_VX_K:
+        for (auto i = first; i < last; ++i)
+        {
+            if (keys_[i] == 0)
+            {
+                pc[i] -= memory::instruction_size;
+            }
+            else
+            {
+                vx[i] = static_cast<uint8_t>(std::countr_zero(keys_[i]));
+            }
+        }
+        break;
+    case Op::LD_DT_VX:
+        std::copy(vx + first, vx + last, delay_timer_.begin() + first);
+        break;
+    case Op::LD_ST_VX:
+        std::copy(vx + first, vx + last, sound_timer_.begin() + first);
+        break;
+    case Op::ADD_I_VX:
+        for (auto i = first; i < last; ++i)
+        {
+            index_[i] += vx[i];
+        }
+        break;
+    case Op::LD_F_VX:
+        for (auto i = first; i < last; ++i)
+        {
+            index_[i] = memory::font_address + vx[i] * font::letter_size;
+        }
+        break;
+    case Op::LD_B_VX:
+        for (auto i = first; i < last; ++i)
+        {
+            // NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers)
+            const std::array<uint8_t, 3> digits{
+                static_cast<uint8_t>((vx[i] / 100) % 10),
+                static_cast<uint8_t>((vx[i] / 10) % 10),
+                static_cast<uint8_t>(vx[i] % 10)};
+            // NOLINTEND(cppcoreguidelines-avoid-magic-numbers)
+            write(i, index_[i], digits);
+        }
+        break;
+    case Op::LD_I_VX:
+        for (auto i = first; i < last; ++i)
+        {
+            std::array<uint8_t, cpu::n_registers> registers{};
+            for (uint8_t x = 0; x <= instr.x; ++x)
+            {
+                registers[x] = reg(x)[i];
+            }
+            write(i, index_[i], std::span{registers}.first(instr.x + 1U));
+        }
+        break;
+    case Op::LD_VX_I:
+        for (auto i = first; i < last; ++i)
+        {
+            for (uint8_t x = 0; x <= instr.x; ++x)
+            {
+                reg(x)[i] = memory_[i][(index_[i] + x) & memory::address_mask];
+            }
+        }
+        break;
+    case Op::UNDECODED:
+    case Op::EMPTY:
+    case Op::UNKNOWN:
+    case Op::SYS_ADDR:
+        break;
+    }
+}
+
+DecodedInstruction VectorEngine::fetch(std::size_t lane) const noexcept
+{
+    const auto pc = pc_[lane];
+    if (is_shared(pc, dirty_[lane]))
+    {
+        return decoded_[pc / memory::instruction_size];
+    }
+
+    auto const& mem = memory_[lane];
+    // NOLINTNEXTLINE(hicpp-signed-bitwise)
+    return decode(static_cast<uint16_t>(
+        (mem[pc] << memory::byte) | mem[(pc + 1) & memory::address_mask]));
+}
+
+bool VectorEngine::is_shared(uint16_t pc, uint64_t dirty) const noexcept
+{
+    // An instruction at an even address lies within a single line. cycle()
+    // has wrapped the pc around the end of memory already.
+    return pc % memory::instruction_size == 0 &&
+           ((dirty >> (pc / line_size)) & 1U) == 0;
+}
+
+void VectorEngine::write(std::size_t lane, uint16_t address,
+                         std::span<const uint8_t> values) noexcept
+{
+    for (std::size_t i = 0; i < values.size(); ++i)
+    {
+        const auto target     = (address + i) & memory::address_mask;
+        memory_[lane][target] = values[i];
+        dirty_[lane] |= uint64_t{1} << (target / line_size);
+    }
+    dirty_any_ |= dirty_[lane];
+}
+
+void VectorEngine::update_timers() noexcept
+{
+    for (auto& timer : delay_timer_)
+    {
+        timer -= timer > 0 ? 1 : 0;
+    }
+    for (auto& timer : sound_timer_)
+    {
+        timer -= timer > 0 ? 1 : 0;
+    }
+}
+
+void VectorEngine::update_dirty() noexcept
+{
+    dirty_any_ = 0;
+    for (const auto dirty : dirty_)
+    {
+        dirty_any_ |= dirty;
+    }
+}
+
+} // namespace chip8
@@ -0,0 +1,164 @@
+#ifndef CHIP_8_VECTOR_ENGINE
+#define CHIP_8_VECTOR_ENGINE
+
+#include "constants.hpp"
+#include "decoder.hpp"
+#include "framebuffer.hpp"
+#include "keypad.hpp"
+#include "random.hpp"
+#include "rom_store.hpp"
+#include "save_state.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <span>
+#include <vector>
+
+namespace chip8
+{
+
+struct VectorEngineConfig
+{
+    // Number of machines, must not be zero.
+    std::size_t instances{64};
+    uint32_t rate{500};
+    // Lane i draws its random numbers from seed + i, so that the lanes do not
+    // all draw the same numbers while the runs stay reproducible.
+    uint64_t seed{};
+};
+
+// Runs many machines of the same ROM in lockstep, e.g. the environments of an
+// agent being trained on a game. The machines are stored as a structure of
+// arrays, one lane per machine: register Vx of all the lanes is contiguous, as
+// are their program counters, index registers, timers and framebuffers.
+//
+// While every lane is at the same instruction of the ROM, it is decoded once
+// and executed for all of them by loops over the lanes, which the compiler
+// turns into SIMD code. Once the lanes diverge, e.g. after skipping on
+// different keys, every lane fetches and executes its own instruction until
+// their program counters meet again. A lane that overwrites its code only
+// runs alone while the overwritten instructions are executed.
+//
+// The machines are headless: the sound timer counts down but plays nothing
+// and the unknown instructions are skipped silently.
+class VectorEngine
+{
+  public:
+    using Config = VectorEngineConfig;
+
+    explicit VectorEngine(Config const& config = {});
+
+    [[nodiscard]] std::size_t size() const noexcept;
+
+    // Loads the ROM in every lane and resets them to their initial state.
+    std::expected<void, LoadRomError> load_rom(std::span<const uint8_t> rom);
+
+    // Emulates n_frames 60 Hz frames of every lane, each one executing rate /
+    // 60 instructions and ticking the timers. key_masks holds the keys held by
+    // every lane for the whole step and must have size() elements.
+    void step(uint64_t n_frames, std::span<const KeyMask> key_masks);
+
+    [[nodiscard]] Framebuffer const& get_framebuffer(
+        std::size_t lane) const noexcept;
+
+    // Snapshot of a lane, in the format of Chip8::save_state(), so that a
+    // lane can be moved to and from a standalone Chip8.
+    [[nodiscard]] SaveState save_state(std::size_t lane) const noexcept;
+    std::expected<void, StateError> load_state(std::size_t lane,
+                                               SaveState const& state);
+
+  private:
+    using Ram = std::array<uint8_t, memory::size>;
+
+    // Memory is tracked in lines of this many bytes, one bit of a uint64_t per
+    // line, to know which lanes have overwritten which part of the ROM.
+    static constexpr std::size_t line_size = memory::size / 64;
+
+    // Puts every lane in the state right after loading image_.
+    void reset() noexcept;
+
+    // Executes one instruction in every lane.
+    void cycle() noexcept;
+
+    // Executes the instruction in the lanes [first, last), whose program
+    // counters already point past it.
+    void execute(DecodedInstruction const& instr, std::size_t first,
+                 std::size_t last) noexcept;
+
+    // The instruction at the program counter of the lane.
+    [[nodiscard]] DecodedInstruction fetch(std::size_t lane) const noexcept;
+
+    // Whether the instruction at pc can be taken from decoded_ by the lanes
+    // that overwrote the given lines.
+    [[nodiscard]] bool is_shared(uint16_t pc, uint64_t dirty) const noexcept;
+
+    // Copies to the memory of the lane, wrapping around its end, and marks
+    // the lines written.
+    void write(std::size_t lane, uint16_t address,
+               std::span<const uint8_t> values) noexcept;
+
+    void update_timers() noexcept;
+
+    // Recomputes the lines overwritten by any lane.
+    void update_dirty() noexcept;
+
+    // Registers Vx of all the lanes.
+    [[nodiscard]] uint8_t* reg(uint8_t x) noexcept;
+    [[nodiscard]] uint8_t const* reg(uint8_t x) const noexcept;
+
+    std::size_t n_;
+    uint32_t rate_;
+    uint64_t seed_;
+    uint64_t frames_{0};
+
+    // Memory right after loading the ROM and its decoding, shared by the
+    // lanes as long as they do not overwrite it.
+    Ram image_{};
+    std::array<DecodedInstruction, memory::size / memory::instruction_size>
+        decoded_{};
+
+    // Structure of arrays, indexed by lane. Vx of a lane is at x * n_ + lane
+    // in v_.
+    std::vector<uint8_t> v_;
+    std::vector<uint16_t> pc_;
+    std::vector<uint16_t> index_;
+    std::vector<std::array<uint16_t, cpu::stack_size>> stack_;
+    std::vector<int8_t> stack_ptr_;
+    std::vector<uint8_t> delay_timer_;
+    std::vector<uint8_t> sound_timer_;
+    std::vector<KeyMask> keys_;
+    std::vector<Random> random_;
+    std::vector<Framebuffer> framebuffers_;
+    std::vector<Ram> memory_;
+
+    // Lines of memory overwritten by each lane and by any lane.
+    std::vector<uint64_t> dirty_;
+    uint64_t dirty_any_{0};
+};
+
+inline std::size_t VectorEngine::size() const noexcept
+{
+    return n_;
+}
+
+inline Framebuffer const& VectorEngine::get_framebuffer(
+    std::size_t lane) const noexcept
+{
+    return framebuffers_[lane];
+}
+
+inline uint8_t* VectorEngine::reg(uint8_t x) noexcept
+{
+    return v_.data() + x * n_;
+}
+
+inline uint8_t const* VectorEngine::reg(uint8_t x) const noexcept
+{
+    return v_.data() + x * n_;
+}
+
+} // namespace chip8
+
+#endif // CHIP_8_VECTOR_ENGINE
@@ -0,0 +1,489 @@
+// chip8-aot: compiles a CHIP-8 ROM ahead of time into a C++ translation unit.
+//
+// The control-flow graph of the ROM is recovered starting from the entry
+// point, following jumps, calls and skips. Every basic block found becomes a
+// C++ function that works directly on the CPU state through AotContext, and
+// the generated file registers them with register_aot_program() so that any
+// Chip8 linked with it runs the ROM through the compiled blocks.
+//
+// Code reachable only through computed jumps (Bnnn), blocks overwritten at
+// runtime and the instructions that wait for a key or are not supported are
+// executed by the interpreter.
+
+#include "chip8.hpp"
+#include "constants.hpp"
+#include "decoder.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cxxopts.hpp>
+#include <deque>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <print>
+#include <set>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// NOLINTNEXTLINE(google-build-using-namespace)
+using namespace chip8;
+
+constexpr uint8_t max_block_size = 64;
+
+struct Block
+{
+    uint16_t address{};
+    std::vector<DecodedInstruction> instructions;
+};
+
+// Instructions left to the interpreter, a block always stops before them.
+bool is_interpreted(Op op) noexcept
+{
+    switch (op)
+    {
+    case Op::UNDECODED:
+    case Op::EMPTY:
+    case Op::UNKNOWN:
+    case Op::SYS_ADDR:
+    case Op::LD_VX_K:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Instructions that set the pc or can overwrite the code, a block always ends
+// with them.
+bool ends_block(Op op) noexcept
+{
+    switch (op)
+    {
+    case Op::RET:
+    case Op::JP_NNN:
+    case Op::CALL:
+    case Op::SE_VX_NN:
+    case Op::SNE_VX_NN:
+    case Op::SE_VX_VY:
+    case Op::SNE_VX_VY:
+    case Op::JP_V0_NNN:
+    case Op::SKP_VX:
+    case Op::NSKP_VX:
+    case Op::LD_B_VX:
+    case Op::LD_I_VX:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Addresses where the execution can continue after the last instruction of a
+// block. Returns and computed jumps have no statically known successor.
+std::vector<uint16_t> successors(DecodedInstruction const& instr,
+                                 uint16_t next)
+{
+    constexpr auto skip = memory::instruction_size;
+
+    switch (instr.op)
+    {
+    case Op::JP_NNN:
+        return {instr.nnn};
+    case Op::CALL:
+        return {instr.nnn, next};
+    case Op::SE_VX_NN:
+    case Op::SNE_VX_NN:
+    case Op::SE_VX_VY:
+    case Op::SNE_VX_VY:
+    case Op::SKP_VX:
+    case Op::NSKP_VX:
+        return {next, static_cast<uint16_t>(next + skip)};
+    case Op::RET:
+    case Op::JP_V0_NNN:
+        return {};
+    default:
+        return {next};
+    }
+}
+
+std::map<uint16_t, Block> recover_blocks(std::span<const uint8_t> rom)
+{
+    const auto rom_end =
+        static_cast<uint16_t>(memory::free_address + rom.size());
+    const auto opcode_at = [rom](uint16_t address) -> uint16_t {
+        const auto offset = address - memory::free_address;
+        // NOLINTNEXTLINE(hicpp-signed-bitwise)
+        return (rom[offset] << memory::byte) | rom[offset + 1];
+    };
+
+    std::map<uint16_t, Block> blocks;
+    std::set<uint16_t> visited;
+    std::deque<uint16_t> worklist{memory::free_address};
+
+    while (!worklist.empty())
+    {
+        const auto address = worklist.front();
+        worklist.pop_front();
+        if (address < memory::free_address || address + 1 >= rom_end ||
+            !visited.insert(address).second)
+        {
+            continue;
+        }
+
+        Block block{.address = address, .instructions = {}};
+        auto pc = address;
+        while (true)
+        {
+            if (pc + 1 >= rom_end ||
+                block.instructions.size() == max_block_size)
+            {
+                worklist.push_back(pc);
+                break;
+            }
+
+            const auto instr = decode(opcode_at(pc));
+            if (is_interpreted(instr.op))
+            {
+                worklist.push_back(pc + memory::instruction_size);
+                break;
+            }
+
+            block.instructions.push_back(instr);
+            pc += memory::instruction_size;
+
+            if (ends_block(instr.op))
+            {
+                std::ranges::copy(successors(instr, pc),
+                                  std::back_inserter(worklist));
+                break;
+            }
+        }
+
+        if (!block.instructions.empty())
+        {
+            blocks.emplace(address, std::move(block));
+        }
+    }
+
+    return blocks;
+}
+
+// Returns the C++ statement executing the instruction at the given address,
+// next is the address of the following instruction.
+std::string translate(DecodedInstruction const& in, uint16_t address,
+                      uint16_t next)
+{
+    const auto x     = in.x;
+    const auto y     = in.y;
+    const auto taken = next + memory::instruction_size;
+
+    switch (in.op)
+    {
+    case Op::RET:
+        return "c.pc = c.stack[chip8::stack_slot(c.sp--)];";
+    case Op::JP_NNN:
+        return std::format("c.pc = 0x{:03X};", in.nnn);
+    case Op::CALL:
+        return std::format("c.stack[chip8::stack_slot(++c.sp)] = 0x{:03X};\n"
+                           "    c.pc = 0x{:03X};",
+                           next, in.nnn);
+    case Op::SE_VX_NN:
+        return std::format(
+            "c.pc = v[0x{:X}] == 0x{:02X} ? 0x{:03X} : 0x{:03X};", x, in.nn,
+            taken, next);
+    case Op::SNE_VX_NN:
+        return std::format(
+            "c.pc = v[0x{:X}] != 0x{:02X} ? 0x{:03X} : 0x{:03X};", x, in.nn,
+            taken, next);
+    case Op::SE_VX_VY:
+        return std::format(
+            "c.pc = v[0x{:X}] == v[0x{:X}] ? 0x{:03X} : 0x{:03X};", x, y, taken,
+            next);
+    case Op::SNE_VX_VY:
+        return std::format(
+            "c.pc = v[0x{:X}] != v[0x{:X}] ? 0x{:03X} : 0x{:03X};", x, y, taken,
+            next);
+    case Op::LD_VX_NN:
+        return std::format("v[0x{:X}] = 0x{:02X};", x, in.nn);
+    case Op::ADD_VX_NN:
+        return std::format(
+            "v[0x{:X}] = static_cast<uint8_t>(v[0x{:X}] + 0x{:02X});", x, x,
+            in.nn);
+    case Op::LD_VX_VY:
+        return std::format("v[0x{:X}] = v[0x{:X}];", x, y);
+    case Op::OR_VX_VY:
+        return std::format("v[0x{:X}] |= v[0x{:X}];", x, y);
+    case Op::AND_VX_VY:
+        return std::format("v[0x{:X}] &= v[0x{:X}];", x, y);
+    case Op::XOR_VX_VY:
+        return std::format("v[0x{:X}] ^= v[0x{:X}];", x, y);
+    case Op::ADD_VX_VY:
+        return std::format("{{\n"
+                           "        const unsigned sum = v[0x{:X}] + "
+                           "v[0x{:X}];\n"
+                           "        v[0x{:X}] = static_cast<uint8_t>(sum);\n"
+                           "        v[0xF] = sum > 0xFF ? 1 : 0;\n"
+                           "    }}",
+                           x, y, x);
+    case Op::SUB_VX_VY:
+    case Op::SUBN_VX_VY:
+    {
+        const bool subn = in.op == Op::SUBN_VX_VY;
+        return std::format("{{\n"
+                           "        const uint8_t a = v[0x{:X}];\n"
+                           "        const uint8_t b = v[0x{:X}];\n"
+                           "        v[0x{:X}] = static_cast<uint8_t>(a - b);\n"
+                           "        v[0xF] = a >= b ? 1 : 0;\n"
+                           "    }}",
+                           subn ? y : x, subn ? x : y, x);
+    }
+    case Op::SHR_VX_VY:
+        return std::format("{{\n"
+                           "        const uint8_t lsb = v[0x{:X}] & 0x1;\n"
+                           "        v[0x{:X}] = "
+                           "static_cast<uint8_t>(v[0x{:X}] >> 1);\n"
+                           "        v[0xF] = lsb;\n"
+                           "    }}",
+                           x, x, x);
+    case Op::SHL_VX_VY:
+        return std::format("{{\n"
+                           "        const uint8_t msb = v[0x{:X}] >> 7;\n"
+                           "        v[0x{:X}] = "
+                           "static_cast<uint8_t>(v[0x{:X}] << 1);\n"
+                           "        v[0xF] = msb;\n"
+                           "    }}",
+                           x, x, x);
+    case Op::LD_I_NNN:
+        return std::format("c.i = 0x{:03X};", in.nnn);
+    case Op::JP_V0_NNN:
+        return std::format("c.pc = static_cast<uint16_t>(v[0x0] + 0x{:03X});",
+                           in.nnn);
+    case Op::SKP_VX:
+        return std::format(
+            "c.pc = c.is_key_pressed(v[0x{:X}]) ? 0x{:03X} : 0x{:03X};", x,
+            taken, next);
+    case Op::NSKP_VX:
+        return std::format(
+            "c.pc = c.is_key_pressed(v[0x{:X}]) ? 0x{:03X} : 0x{:03X};", x,
+            next, taken);
+    case Op::LD_VX_DT:
+        return std::format("v[0x{:X}] = c.dt;", x);
+    case Op::LD_DT_VX:
+        return std::format("c.dt = v[0x{:X}];", x);
+    case Op::LD_ST_VX:
+        return std::format("c.st = v[0x{:X}];", x);
+    case Op::ADD_I_VX:
+        return std::format("c.i = static_cast<uint16_t>(c.i + v[0x{:X}]);", x);
+    case Op::LD_F_VX:
+        return std::format(
+            "c.i = static_cast<uint16_t>(0x{:03X} + v[0x{:X}] * {});",
+            memory::font_address, x, font::letter_size);
+    case Op::LD_B_VX:
+    case Op::LD_I_VX:
+        return std::format("c.execute(instr_{:03X});\n"
+                           "    c.pc = 0x{:03X};",
+                           address, next);
+    default:
+        // Display, random number generator and memory loads are delegated to
+        // the CPU handlers.
+        return std::format("c.execute(instr_{:03X});", address);
+    }
+}
+
+bool needs_decoded_instruction(Op op) noexcept
+{
+    switch (op)
+    {
+    case Op::CLS:
+    case Op::RND_VX_NN:
+    case Op::DRW_VX_VY_N:
+    case Op::LD_B_VX:
+    case Op::LD_I_VX:
+    case Op::LD_VX_I:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void emit(std::ostream& out, std::string const& rom_path,
+          std::span<const uint8_t> rom,
+          std::map<uint16_t, Block> const& blocks)
+{
+    std::println(out, "// Generated by chip8-aot from {}, do not edit.",
+                 rom_path);
+    std::println(out, "");
+    std::println(out, "#include \"aot.hpp\"");
+    std::println(out, "#include \"decoder.hpp\"");
+    std::println(out, "#include \"machine_state.hpp\"");
+    std::println(out, "");
+    std::println(out, "#include <array>");
+    std::println(out, "#include <cstdint>");
+    std::println(out, "");
+    std::println(out, "// NOLINTBEGIN");
+    std::println(out, "namespace");
+    std::println(out, "{{");
+    std::println(out, "");
+
+    std::print(out, "constexpr std::array<uint8_t, {}> rom{{", rom.size());
+    for (std::size_t i = 0; i < rom.size(); ++i)
+    {
+        std::print(out, "{}0x{:02X},", i % 12 == 0 ? "\n    " : " ", rom[i]);
+    }
+    std::println(out, "\n}};");
+    std::println(out, "");
+
+    // Overlapping blocks share the same decoded instructions.
+    std::map<uint16_t, uint16_t> decoded;
+    for (const auto& [address, block] : blocks)
+    {
+        auto pc = address;
+        for (const auto& instr : block.instructions)
+        {
+            if (needs_decoded_instruction(instr.op))
+            {
+                decoded.emplace(pc, instr.opcode);
+            }
+            pc += memory::instruction_size;
+        }
+    }
+    for (const auto& [address, opcode] : decoded)
+    {
+        std::println(out,
+                     "constexpr auto instr_{:03X} = chip8::decode(0x{:04X});",
+                     address, opcode);
+    }
+    std::println(out, "");
+
+    for (const auto& [address, block] : blocks)
+    {
+        std::println(out, "void block_{:03X}(chip8::AotContext& c)", address);
+        std::println(out, "{{");
+        std::println(out, "    [[maybe_unused]] auto* v = c.v;");
+
+        auto pc = address;
+        for (const auto& instr : block.instructions)
+        {
+            const auto next =
+                static_cast<uint16_t>(pc + memory::instruction_size);
+            std::println(out, "    {}", translate(instr, pc, next));
+            pc = next;
+        }
+        if (!ends_block(block.instructions.back().op))
+        {
+            std::println(out, "    c.pc = 0x{:03X};", pc);
+        }
+
+        std::println(out, "}}");
+        std::println(out, "");
+    }
+
+    std::println(out, "constexpr std::array<chip8::AotBlock, {}> blocks{{{{",
+                 blocks.size());
+    for (const auto& [address, block] : blocks)
+    {
+        std::println(out, "    {{0x{:03X}, {}, &block_{:03X}}},", address,
+                     block.instructions.size(), address);
+    }
+    std::println(out, "}}}};");
+    std::println(out, "");
+    std::println(out, "const bool registered = chip8::register_aot_program(");
+    std::println(out,
+                 "    chip8::AotProgram{{.rom = rom, .blocks = blocks}});");
+    std::println(out, "");
+    std::println(out, "}} // namespace");
+    std::println(out, "// NOLINTEND");
+}
+
+void print_load_rom_error(LoadRomError error)
+{
+    switch (error)
+    {
+        using enum LoadRomError;
+    case FILE_NOT_FOUND:
+        std::println(std::cerr, "Error: ROM not found");
+        break;
+    case ROM_EMPTY:
+        std::println(std::cerr, "Error: ROM is empty");
+        break;
+    case ROM_TOO_BIG:
+        std::println(std::cerr, "Error: ROM exceeds maximum size");
+        break;
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    cxxopts::Options options("chip8-aot",
+                             "Compiles a CHIP-8 ROM ahead of time into C++");
+
+    // clang-format off
+    options.add_options()
+        ("o,output", "Path of the C++ file to generate, stdout if missing",
+            cxxopts::value<std::string>())
+        ("rom", "Path to the ROM file to compile",
+            cxxopts::value<std::string>())
+        ("h,help", "Print help information");
+    // clang-format on
+
+    options.parse_positional({"rom"});
+    options.positional_help("<rom>");
+
+    try
+    {
+        auto result = options.parse(argc, argv);
+
+        if (result.contains("help"))
+        {
+            std::println("{}", options.help());
+            return EXIT_SUCCESS;
+        }
+
+        if (!result.contains("rom"))
+        {
+            std::println(std::cerr,
+                         "Error: ROM is required, use --help for more info");
+            return EXIT_FAILURE;
+        }
+
+        const auto rom_path = result["rom"].as<std::string>();
+        const auto rom      = read_rom(rom_path);
+        if (!rom)
+        {
+            print_load_rom_error(rom.error());
+            return EXIT_FAILURE;
+        }
+
+        const auto blocks = recover_blocks(*rom);
+
+        if (result.contains("output"))
+        {
+            std::ofstream out(result["output"].as<std::string>());
+            emit(out, rom_path, *rom, blocks);
+            if (!out)
+            {
+                std::println(std::cerr, "Error: cannot write the output file");
+                return EXIT_FAILURE;
+            }
+        }
+        else
+        {
+            emit(std::cout, rom_path, *rom, blocks);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::println(std::cerr, "Error parsing arguments: {}", e.what());
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,238 @@
+// chip8-batch: runs many CHIP-8 ROMs headless and in parallel.
+//
+// Every ROM runs in turbo mode on its own emulator instance for a fixed
+// number of instructions. For each of them a line with the hash of the final
+// framebuffer, the executed instructions and the wall time is printed, in the
+// order the ROMs were given, so that two runs can be compared with diff.
+//
+// The budgets can be given per ROM with --list, a file with one
+// "<rom> [cycles [state]]" entry per line, the ROMs without a budget use
+// --cycles. A save state given in the list is restored before running.
+
+#include "batch_runner.hpp"
+#include "chip8.hpp"
+#include "save_state.hpp"
+#include "utility.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cxxopts.hpp>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <print>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// NOLINTNEXTLINE(google-build-using-namespace)
+using namespace chip8;
+
+std::optional<std::vector<BatchJob>> read_job_list(std::string const& path,
+                                                   uint64_t default_cycles)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        std::println(std::cerr, "Error: cannot open the ROM list {}", path);
+        return std::nullopt;
+    }
+
+    std::vector<BatchJob> jobs;
+    std::string line;
+    for (std::size_t n = 1; std::getline(file, line); ++n)
+    {
+        std::istringstream fields(line);
+        BatchJob job{.rom = {}, .cycles = default_cycles, .state = {}};
+        if (!(fields >> job.rom) || job.rom.starts_with('#'))
+        {
+            continue;
+        }
+        fields >> std::ws;
+        if (!fields.eof() && (!(fields >> job.cycles) || job.cycles == 0))
+        {
+            std::println(std::cerr, "Error: invalid cycle budget at {}:{}",
+                         path, n);
+            return std::nullopt;
+        }
+        fields >> job.state;
+        jobs.push_back(std::move(job));
+    }
+    return jobs;
+}
+
+const char* describe(LoadRomError error)
+{
+    switch (error)
+    {
+        using enum LoadRomError;
+    case FILE_NOT_FOUND:
+        return "ROM not found";
+    case ROM_EMPTY:
+        return "ROM is empty";
+    case ROM_TOO_BIG:
+        return "ROM exceeds maximum size";
+    }
+    return "unknown error";
+}
+
+int run_batch(std::vector<BatchJob> const& jobs, BatchRunner::Config config)
+{
+    const BatchRunner runner(config);
+
+    const auto start_time = std::chrono::steady_clock::now();
+    const auto results    = runner.run(jobs);
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start_time;
+
+    int ret         = EXIT_SUCCESS;
+    uint64_t cycles = 0;
+    for (auto const& result : results)
+    {
+        if (result.error)
+        {
+            std::println(std::cerr, "Error: {}: {}", result.rom,
+                         describe(*result.error));
+            ret = EXIT_FAILURE;
+            continue;
+        }
+        if (result.state_error)
+        {
+            std::println(std::cerr, "Error: {}: {}", result.rom,
+                         to_string(*result.state_error));
+            ret = EXIT_FAILURE;
+            continue;
+        }
+        std::println("{:016x} {:>12} {:>9.3f}s {}", result.framebuffer_hash,
+                     result.cycles, result.elapsed.count(), result.rom);
+        cycles += result.cycles;
+    }
+
+    std::println(std::cerr,
+                 "Ran {} ROMs, {} instructions in {:.3f}s ({:.0f} IPS)",
+                 results.size(), cycles, elapsed.count(),
+                 elapsed.count() > 0.0
+                     ? static_cast<double>(cycles) / elapsed.count()
+                     : 0.0);
+    return ret;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    cxxopts::Options options("chip8-batch",
+                             "Runs many CHIP-8 ROMs headless and in parallel");
+
+    // clang-format off
+    options.add_options()
+        ("c,cycles", "Instructions to execute for the ROMs without a budget",
+            cxxopts::value<uint64_t>()->default_value("1000000"))
+        ("l,list", "File with one \"<rom> [cycles [state]]\" entry per line",
+            cxxopts::value<std::string>())
+        ("j,jobs", "Number of worker threads (0 = one per core)",
+            cxxopts::value<unsigned>()->default_value("0"))
+        ("r,rate", "Instructions per second, sets how often timers tick",
+            cxxopts::value<uint32_t>()->default_value("500"))
+        ("cpu", "CPU backend: interpreter, blocks or jit",
+            cxxopts::value<std::string>()->default_value("interpreter"))
+        ("profile", "Quirks: default, cosmac-vip, super-chip or xo-chip",
+            cxxopts::value<std::string>()->default_value("default"))
+        ("seed", "Seed of the random numbers of every job",
+            cxxopts::value<uint64_t>()->default_value("0"))
+        ("roms", "Paths to the ROM files to run",
+            cxxopts::value<std::vector<std::string>>())
+        ("h,help", "Print help information");
+    // clang-format on
+
+    options.parse_positional({"roms"});
+    options.positional_help("<rom>...");
+
+    try
+    {
+        auto result = options.parse(argc, argv);
+
+        if (result.contains("help"))
+        {
+            std::println("{}", options.help());
+            return EXIT_SUCCESS;
+        }
+
+        const auto cycles = result["cycles"].as<uint64_t>();
+        if (cycles == 0)
+        {
+            std::println(std::cerr, "Error: the cycle budget must not be 0");
+            return EXIT_FAILURE;
+        }
+
+        const auto rate = result["rate"].as<uint32_t>();
+        if (rate == 0)
+        {
+            std::println(std::cerr, "Error: the rate must not be 0");
+            return EXIT_FAILURE;
+        }
+
+        const auto cpu = utility::argparse::parse_cpu_backend(
+            result["cpu"].as<std::string>());
+        if (!cpu)
+        {
+            std::println(
+                std::cerr,
+                "Error: unknown CPU backend, use --help for more info");
+            return EXIT_FAILURE;
+        }
+
+        const auto profile = utility::argparse::parse_profile(
+            result["profile"].as<std::string>());
+        if (!profile)
+        {
+            std::println(std::cerr,
+                         "Error: unknown profile, use --help for more info");
+            return EXIT_FAILURE;
+        }
+
+        std::vector<BatchJob> jobs;
+        if (result.contains("list"))
+        {
+            auto listed =
+                read_job_list(result["list"].as<std::string>(), cycles);
+            if (!listed)
+            {
+                return EXIT_FAILURE;
+            }
+            jobs = std::move(*listed);
+        }
+        if (result.contains("roms"))
+        {
+            const auto roms = result["roms"].as<std::vector<std::string>>();
+            for (auto const& rom : roms)
+            {
+                jobs.push_back(
+                    BatchJob{.rom = rom, .cycles = cycles, .state = {}});
+            }
+        }
+
+        if (jobs.empty())
+        {
+            std::println(std::cerr,
+                         "Error: no ROM given, use --help for more info");
+            return EXIT_FAILURE;
+        }
+
+        return run_batch(jobs, BatchRunner::Config{
+                                   .threads = result["jobs"].as<unsigned>(),
+                                   .rate    = rate,
+                                   .backend = *cpu,
+                                   .profile = *profile,
+                                   .seed    = result["seed"].as<uint64_t>()});
+    }
+    catch (const std::exception& e)
+    {
+        std::println(std::cerr, "Error parsing arguments: {}", e.what());
+        return EXIT_FAILURE;
+    }
+}
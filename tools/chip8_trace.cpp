@@ -0,0 +1,134 @@
+// chip8-trace: prints an instruction trace written with --trace.
+//
+// Every record is printed on one line with the cycle, the address and the
+// opcode of the instruction, the I register and the V registers it changed.
+// All the registers are printed for the first record and after records were
+// dropped, when the previous values are not known.
+
+#include "trace.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cxxopts.hpp>
+#include <format>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <print>
+#include <string>
+
+namespace
+{
+
+// NOLINTNEXTLINE(google-build-using-namespace)
+using namespace chip8;
+
+std::string format_record(TraceRecord const& record,
+                          std::optional<TraceRecord> const& previous)
+{
+    std::string line =
+        std::format("{:>12} {:04x} {:04x} I={:04x}", record.cycle, record.pc,
+                    record.opcode, record.index);
+    for (std::size_t i = 0; i < record.registers.size(); ++i)
+    {
+        if (!previous || previous->registers[i] != record.registers[i])
+        {
+            std::format_to(std::back_inserter(line), " V{:X}={:02x}", i,
+                           record.registers[i]);
+        }
+    }
+    return line;
+}
+
+int print_trace(std::string const& path, uint64_t first, uint64_t count)
+{
+    TraceReader reader(path);
+    if (const auto error = reader.get_error())
+    {
+        std::println(std::cerr, "Error: {}: {}", path, to_string(*error));
+        return EXIT_FAILURE;
+    }
+
+    std::optional<TraceRecord> previous;
+    uint64_t printed = 0;
+    TraceRecord record;
+    while (printed < count && reader.next(record))
+    {
+        if ((record.flags & TraceRecord::dropped_flag) != 0)
+        {
+            previous.reset();
+        }
+        if (record.cycle < first)
+        {
+            previous = record;
+            continue;
+        }
+        if (!previous && printed != 0)
+        {
+            std::println("-- records dropped");
+        }
+        std::println("{}", format_record(record, printed == 0
+                                                     ? std::nullopt
+                                                     : previous));
+        previous = record;
+        ++printed;
+    }
+
+    if (const auto error = reader.get_error())
+    {
+        std::println(std::cerr, "Error: {}: {}", path, to_string(*error));
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    cxxopts::Options options("chip8-trace",
+                             "Prints a CHIP-8 instruction trace");
+
+    // clang-format off
+    options.add_options()
+        ("s,start", "Cycle of the first record to print",
+            cxxopts::value<uint64_t>()->default_value("0"))
+        ("n,count", "Maximum number of records to print (0 = all)",
+            cxxopts::value<uint64_t>()->default_value("0"))
+        ("trace", "Path to the trace file",
+            cxxopts::value<std::string>())
+        ("h,help", "Print help information");
+    // clang-format on
+
+    options.parse_positional({"trace"});
+    options.positional_help("<trace>");
+
+    try
+    {
+        auto result = options.parse(argc, argv);
+
+        if (result.contains("help"))
+        {
+            std::println("{}", options.help());
+            return EXIT_SUCCESS;
+        }
+
+        if (!result.contains("trace"))
+        {
+            std::println(std::cerr,
+                         "Error: no trace given, use --help for more info");
+            return EXIT_FAILURE;
+        }
+
+        const auto count = result["count"].as<uint64_t>();
+        return print_trace(result["trace"].as<std::string>(),
+                           result["start"].as<uint64_t>(),
+                           count == 0 ? UINT64_MAX : count);
+    }
+    catch (const std::exception& e)
+    {
+        std::println(std::cerr, "Error parsing arguments: {}", e.what());
+        return EXIT_FAILURE;
+    }
+}